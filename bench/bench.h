@@ -0,0 +1,47 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+//Simple wall clock timer for the benchmarks
+class BenchTimer {
+private:
+    std::chrono::steady_clock::time_point start;
+
+public:
+    BenchTimer() : start(std::chrono::steady_clock::now()) {}
+
+    inline void reset() { start = std::chrono::steady_clock::now(); }
+
+    inline double seconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+//Prevent the compiler from removing a computed result
+template<typename V>
+inline void benchKeep(const V& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+//Read an optional size argument from the command line
+inline long benchArg(int argc, char** argv, int index, long fallback) {
+    return (argc > index) ? std::atol(argv[index]) : fallback;
+}
+
+inline void benchReport(const std::string& name, double value, const std::string& unit) {
+    std::cout << std::left << std::setw(48) << name
+              << std::right << std::setw(14) << std::fixed << std::setprecision(2) << value
+              << " " << unit << std::endl;
+}
+
+#endif /* BENCH_H */
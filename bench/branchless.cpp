@@ -0,0 +1,138 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Random lookups with the branchless descent for small keys against the
+// generic descent. Branch misses are read from the hardware counters where
+// perf_event_open is available.
+// Usage: branchless [keys] [lookups]
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "bench.h"
+#include "rbtree.h"
+using namespace std;
+
+//Same key as int, but the copy constructor forces the generic path
+struct BoxedInt {
+    int value;
+
+    BoxedInt(int value) : value(value) {}
+    BoxedInt(const BoxedInt& other) : value(other.value) {}
+
+    bool operator< (const BoxedInt& other) const { return value < other.value; }
+};
+
+//Hardware branch miss counter of the calling thread, -1 when unavailable
+class BranchMisses {
+    private:
+        int fd;
+
+    public:
+        BranchMisses() : fd(-1) {
+            #ifdef __linux__
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+            #endif
+        }
+
+        ~BranchMisses() {
+            #ifdef __linux__
+            if (fd >= 0) close(fd);
+            #endif
+        }
+
+        void start() {
+            #ifdef __linux__
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+            #endif
+        }
+
+        long stop() {
+            long long count = -1;
+
+            #ifdef __linux__
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+                if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+                    count = -1;
+                }
+            }
+            #endif
+
+            return (long)count;
+        }
+};
+
+template<typename Tree>
+void run(const string& name, const vector<int>& keys, const vector<int>& probes) {
+    Tree tree;
+
+    for (size_t i = 0; i < keys.size(); i++) {
+        tree.insert(keys[i]);
+    }
+
+    BranchMisses misses;
+    BenchTimer timer;
+    long hits = 0;
+
+    misses.start();
+
+    for (size_t i = 0; i < probes.size(); i++) {
+        hits += tree.contains(probes[i]);
+    }
+
+    long missed = misses.stop();
+    double seconds = timer.seconds();
+    benchKeep(hits);
+
+    benchReport(name + " lookup", seconds * 1e9 / probes.size(), "ns");
+
+    if (missed < 0) {
+        cout << std::left << setw(48) << (name + " branch misses per lookup") << std::right << setw(14) << "n/a" << endl;
+    } else {
+        benchReport(name + " branch misses per lookup", (double)missed / probes.size(), "");
+    }
+}
+
+int main(int argc, char** argv) {
+    int amount = (int)benchArg(argc, argv, 1, 100000);
+    int lookups = (int)benchArg(argc, argv, 2, 5000000);
+    vector<int> keys(amount);
+
+    for (int i = 0; i < amount; i++) {
+        keys[i] = i * 2;
+    }
+
+    random_shuffle(keys.begin(), keys.end());
+
+    //Half of the probes miss the tree
+    vector<int> probes(lookups);
+    for (int i = 0; i < lookups; i++) {
+        probes[i] = rand() % (amount * 2);
+    }
+
+    run<RBTree<BoxedInt>>("generic", keys, probes);
+    run<RBTree<int>>("branchless", keys, probes);
+    return 0;
+}
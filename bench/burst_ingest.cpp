@@ -0,0 +1,80 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Burst of random inserts into a filled tree with and without the write
+// buffer, and the lookup latency right after the burst.
+// Usage: burst_ingest [keys] [burst]
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+#include "rbtree_buffer.h"
+using namespace std;
+
+template<typename Tree>
+void run(const string& name, Tree& tree, const vector<int>& burst, const vector<int>& probes) {
+    BenchTimer timer;
+
+    for (size_t i = 0; i < burst.size(); i++) {
+        tree.insert(burst[i]);
+    }
+
+    benchReport(name + " burst", timer.seconds() * 1e9 / burst.size(), "ns/insert");
+
+    //The first lookup may have to sort the buffered keys
+    timer.reset();
+    size_t hits = tree.contains(probes[0]);
+    benchReport(name + " first lookup", timer.seconds() * 1e6, "us");
+
+    timer.reset();
+
+    for (size_t i = 1; i < probes.size(); i++) {
+        hits += tree.contains(probes[i]);
+    }
+
+    benchReport(name + " next lookups", timer.seconds() * 1e9 / (probes.size() - 1), "ns");
+    benchKeep(hits);
+}
+
+int main(int argc, char** argv) {
+    long amount = benchArg(argc, argv, 1, 1000000);
+    long size = benchArg(argc, argv, 2, 1000000);
+
+    mt19937 random(17);
+    vector<int> keys(amount);
+    vector<int> burst(size);
+    vector<int> probes(100000);
+
+    for (long i = 0; i < amount; i++) keys[i] = (int)random();
+    for (long i = 0; i < size; i++) burst[i] = (int)random();
+    for (size_t i = 0; i < probes.size(); i++) probes[i] = burst[random() % size];
+
+    {
+        RBTree<int> tree;
+        tree.insert(keys.begin(), keys.end());
+        run("tree", tree, burst, probes);
+    }
+
+    {
+        RBBufferedTree<int> tree;
+        tree.insert(keys.begin(), keys.end());
+        run("buffered tree (64K)", tree, burst, probes);
+    }
+
+    {
+        //The whole burst is merged in one batch on the first iteration
+        RBBufferedTree<int> tree(size + 1);
+        tree.insert(keys.begin(), keys.end());
+        run("buffered tree (whole burst)", tree, burst, probes);
+
+        BenchTimer timer;
+        tree.flush();
+        benchReport("buffered tree (whole burst) merge", timer.seconds() * 1e3, "ms");
+    }
+
+    return 0;
+}
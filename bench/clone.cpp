@@ -0,0 +1,100 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Structural clone against cloning by re-inserting every key, and the heap
+// memory of many clones of small trees.
+// Usage: clone [keys]
+#include <malloc.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+using namespace std;
+
+typedef RBTree<int> IntTree;
+
+long lookups(IntTree& tree, const vector<int>& keys) {
+    long hits = 0;
+
+    for (size_t i = 0; i < keys.size(); i++) {
+        hits += tree.contains(keys[i]);
+    }
+
+    return hits;
+}
+
+int main(int argc, char** argv) {
+    int amount = (int)benchArg(argc, argv, 1, 1000000);
+    vector<int> keys(amount);
+
+    for (int i = 0; i < amount; i++) {
+        keys[i] = i;
+    }
+
+    random_shuffle(keys.begin(), keys.end());
+
+    IntTree tree;
+    for (int i = 0; i < amount; i++) {
+        tree.insert(keys[i]);
+    }
+
+    BenchTimer timer;
+    IntTree reinserted;
+
+    for (IntTree::iterator it = tree.begin(); it != tree.end(); ++it) {
+        reinserted.insert(*it);
+    }
+
+    benchReport("clone by re-inserting", timer.seconds() * 1e3, "ms");
+
+    timer.reset();
+    IntTree cloned(tree);
+    benchReport("copy constructor", timer.seconds() * 1e3, "ms");
+
+    timer.reset();
+    IntTree moved(std::move(reinserted));
+    benchReport("move constructor", timer.seconds() * 1e6, "us");
+
+    //Lookups profit from the contiguous pre-order layout of the clone
+    random_shuffle(keys.begin(), keys.end());
+
+    timer.reset();
+    benchKeep(lookups(tree, keys));
+    benchReport("random lookups in the original", timer.seconds() * 1e3, "ms");
+
+    timer.reset();
+    benchKeep(lookups(cloned, keys));
+    benchReport("random lookups in the clone", timer.seconds() * 1e3, "ms");
+
+    timer.reset();
+    cloned = IntTree();
+    benchReport("destroying the clone", timer.seconds() * 1e3, "ms");
+
+    //A small clone should not take a whole block
+    const int smallSizes[] = {1, 16, 100};
+
+    for (int s = 0; s < 3; s++) {
+        IntTree small;
+        vector<IntTree> copies;
+        copies.reserve(1000);
+
+        for (int i = 0; i < smallSizes[s]; i++) {
+            small.insert(i);
+        }
+
+        size_t before = mallinfo2().uordblks;
+
+        for (int i = 0; i < 1000; i++) {
+            copies.push_back(small);
+        }
+
+        size_t used = mallinfo2().uordblks - before;
+        benchReport("heap per clone of " + to_string(smallSizes[s]) + " keys", used / 1000.0, "bytes");
+    }
+
+    return 0;
+}
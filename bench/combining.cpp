@@ -0,0 +1,115 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Flat combining against a mutex and a reader-writer lock around the tree.
+// Every thread runs a write-heavy (50% inserts, 50% removes) and a
+// read-heavy (90% lookups) mix of operations on random keys.
+// Usage: combining [keys] [operations per thread] [max threads]
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+#include "rbtree_combining.h"
+using namespace std;
+
+typedef RBTree<long> LongTree;
+
+//Tree behind a single mutex
+class MutexTree {
+private:
+    LongTree tree;
+    mutex lock;
+
+public:
+    bool insert(long key) { lock_guard<mutex> guard(lock); return tree.insert(key); }
+    bool remove(long key) { lock_guard<mutex> guard(lock); return tree.remove(key); }
+    bool contains(long key) { lock_guard<mutex> guard(lock); return tree.contains(key); }
+};
+
+//Tree behind a reader-writer lock, lookups share the lock
+class SharedTree {
+private:
+    LongTree tree;
+    shared_timed_mutex lock;
+
+public:
+    bool insert(long key) { lock_guard<shared_timed_mutex> guard(lock); return tree.insert(key); }
+    bool remove(long key) { lock_guard<shared_timed_mutex> guard(lock); return tree.remove(key); }
+    bool contains(long key) { shared_lock<shared_timed_mutex> guard(lock); return tree.contains(key); }
+};
+
+//Operations per second of all threads together
+template<typename Tree>
+double run(Tree& tree, long amount, long operations, unsigned int threads, unsigned int readPercent) {
+    vector<thread> workers;
+    BenchTimer timer;
+
+    for (unsigned int t = 0; t < threads; t++) {
+        workers.push_back(thread([&tree, amount, operations, readPercent, t]() {
+            unsigned long state = t * 2654435761UL + 1;
+            long found = 0;
+
+            for (long i = 0; i < operations; i++) {
+                state = state * 6364136223846793005UL + 1442695040888963407UL;
+                long key = (long)((state >> 33) % amount);
+                unsigned int kind = (state >> 20) % 100;
+
+                if (kind < readPercent) {
+                    found += tree.contains(key);
+                } else if (kind % 2 == 0) {
+                    found += tree.insert(key);
+                } else {
+                    found += tree.remove(key);
+                }
+            }
+
+            benchKeep(found);
+        }));
+    }
+
+    for (unsigned int t = 0; t < threads; t++) {
+        workers[t].join();
+    }
+
+    return threads * operations / timer.seconds();
+}
+
+template<typename Tree>
+void fillTree(Tree& tree, long amount) {
+    for (long i = 0; i < amount; i += 2) {
+        tree.insert(i);
+    }
+}
+
+int main(int argc, char** argv) {
+    long amount = benchArg(argc, argv, 1, 1000000);
+    long operations = benchArg(argc, argv, 2, 200000);
+    unsigned int maxThreads = (unsigned int)benchArg(argc, argv, 3, 64);
+    const unsigned int mixes[] = {0, 90};
+
+    for (unsigned int m = 0; m < 2; m++) {
+        unsigned int reads = mixes[m];
+
+        for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+            MutexTree locked;
+            SharedTree shared;
+            RBCombiningTree<long> combining;
+            fillTree(locked, amount);
+            fillTree(shared, amount);
+            fillTree(combining, amount);
+
+            string mix = to_string(reads) + "% lookups, " + to_string(threads) + " threads";
+            benchReport("mutex, " + mix, run(locked, amount, operations, threads, reads) / 1e6, "Mops/s");
+            benchReport("reader-writer lock, " + mix, run(shared, amount, operations, threads, reads) / 1e6, "Mops/s");
+            benchReport("flat combining, " + mix, run(combining, amount, operations, threads, reads) / 1e6, "Mops/s");
+        }
+    }
+
+    benchReport("hardware threads", std::thread::hardware_concurrency(), "");
+    return 0;
+}
@@ -0,0 +1,93 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Lookup latency of an aged tree before and after defragment().
+// Usage: defragment [keys] [churn rounds] [lookups]
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+using namespace std;
+
+typedef RBTree<long> LongTree;
+
+double lookupLatency(LongTree& tree, const vector<long>& probes) {
+    BenchTimer timer;
+    long hits = 0;
+
+    for (size_t i = 0; i < probes.size(); i++) {
+        hits += tree.contains(probes[i]);
+    }
+
+    benchKeep(hits);
+    return timer.seconds() * 1e9 / probes.size();
+}
+
+int main(int argc, char** argv) {
+    long amount = benchArg(argc, argv, 1, 2000000);
+    long rounds = benchArg(argc, argv, 2, 4000000);
+    long lookups = benchArg(argc, argv, 3, 2000000);
+
+    mt19937_64 random(7);
+    vector<long> keys(amount);
+
+    for (long i = 0; i < amount; i++) {
+        keys[i] = i * 2;
+    }
+
+    //Both trees are aged in lockstep, one for each kind of relayout
+    LongTree tree;
+    LongTree incremental;
+
+    for (long i = 0; i < amount; i++) {
+        tree.insert(keys[i]);
+        incremental.insert(keys[i]);
+    }
+
+    vector<long> probes(lookups);
+    for (long i = 0; i < lookups; i++) {
+        probes[i] = keys[random() % amount];
+    }
+
+    benchReport("lookup, fresh tree", lookupLatency(tree, probes), "ns");
+
+    //Age the tree: random removes and inserts scatter the nodes over the heap
+    for (long i = 0; i < rounds; i++) {
+        size_t slot = random() % amount;
+        tree.remove(keys[slot]);
+        incremental.remove(keys[slot]);
+        keys[slot] = (long)(random() % (amount * 4)) * 2;
+        tree.insert(keys[slot]);
+        incremental.insert(keys[slot]);
+    }
+
+    for (long i = 0; i < lookups; i++) {
+        probes[i] = keys[random() % amount];
+    }
+
+    benchReport("lookup, aged tree", lookupLatency(tree, probes), "ns");
+
+    BenchTimer timer;
+    tree.defragment();
+    benchReport("defragment()", timer.seconds() * 1e3, "ms");
+    benchReport("lookup, after defragment()", lookupLatency(tree, probes), "ns");
+
+    //The incremental relayout moves the nodes in key order
+    double longest = 0;
+
+    while (true) {
+        timer.reset();
+        bool done = incremental.defragment_step(10000);
+        longest = std::max(longest, timer.seconds());
+
+        if (done) break;
+    }
+
+    benchReport("defragment_step(10000), longest step", longest * 1e3, "ms");
+    benchReport("lookup, after incremental relayout", lookupLatency(incremental, probes), "ns");
+    return 0;
+}
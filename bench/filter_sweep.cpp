@@ -0,0 +1,85 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Lookups with and without the membership filter for hit ratios from 0%
+// to 100%, and the measured false positive rate of the filter.
+// Usage: filter_sweep [keys] [lookups]
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+#include "rbtree_filter.h"
+using namespace std;
+
+template<typename Tree>
+double lookupTime(Tree& tree, const vector<int>& probes) {
+    BenchTimer timer;
+    size_t hits = 0;
+
+    for (size_t i = 0; i < probes.size(); i++) {
+        hits += tree.contains(probes[i]);
+    }
+
+    double seconds = timer.seconds();
+    benchKeep(hits);
+    return seconds * 1e9 / probes.size();
+}
+
+int main(int argc, char** argv) {
+    long amount = benchArg(argc, argv, 1, 1000000);
+    long lookups = benchArg(argc, argv, 2, 2000000);
+
+    //Even numbers are stored, odd numbers always miss
+    vector<int> keys(amount);
+
+    for (long i = 0; i < amount; i++) {
+        keys[i] = (int)(i * 2);
+    }
+
+    mt19937 random(5);
+    shuffle(keys.begin(), keys.end(), random);
+
+    RBTree<int> plain;
+    RBFilteredTree<int> filtered;
+
+    for (long i = 0; i < amount; i++) {
+        plain.insert(keys[i]);
+        filtered.insert(keys[i]);
+    }
+
+    RBBloomFilter filter(filtered.filterCapacity());
+    size_t falsePositives = 0;
+
+    for (long i = 0; i < amount; i++) {
+        filter.add(hash<int>()(keys[i]));
+    }
+
+    for (long i = 0; i < amount; i++) {
+        falsePositives += filter.mayContain(hash<int>()(keys[i] + 1));
+    }
+
+    benchReport("filter false positives", 100.0 * falsePositives / amount, "%");
+    benchReport("filter bytes/key",
+                (double)filtered.filterCapacity() * RBBloomFilter::COUNTERS_PER_KEY / 2 / amount, "bytes");
+
+    for (int ratio = 0; ratio <= 100; ratio += 20) {
+        vector<int> probes(lookups);
+
+        for (long i = 0; i < lookups; i++) {
+            int key = keys[random() % amount];
+            probes[i] = ((long)(random() % 100) < ratio) ? key : key + 1;
+        }
+
+        string hits = to_string(ratio) + "% hits ";
+        benchReport(hits + "tree", lookupTime(plain, probes), "ns");
+        benchReport(hits + "filtered tree", lookupTime(filtered, probes), "ns");
+    }
+
+    return 0;
+}
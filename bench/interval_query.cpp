@@ -0,0 +1,67 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Overlap and stabbing queries of the interval tree against a linear scan
+// over all intervals of the tree.
+// Usage: interval_query [intervals] [queries]
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+#include "rbtree_interval.h"
+using namespace std;
+
+int main(int argc, char** argv) {
+    long amount = benchArg(argc, argv, 1, 1000000);
+    long queries = benchArg(argc, argv, 2, 100000);
+
+    //Sessions within a day in milliseconds, mostly short with a few long ones
+    const long range = 86400000;
+    mt19937 random(9);
+    RBIntervalTree<long> tree;
+
+    for (long i = 0; i < amount; i++) {
+        long start = random() % range;
+        long length = (random() % 100 == 0) ? random() % 3600000 : random() % 60000;
+        tree.insert(RBInterval<long>(start, start + length));
+    }
+
+    vector<long> points(queries);
+
+    for (long i = 0; i < queries; i++) {
+        points[i] = random() % range;
+    }
+
+    //Linear scans are much slower, a fraction of the queries is enough
+    long scans = queries / 1000 + 1;
+    size_t found = 0;
+    BenchTimer timer;
+
+    for (long i = 0; i < scans; i++) {
+        for (RBIntervalTree<long>::iterator it = tree.begin(); it != tree.end(); ++it) {
+            found += it->overlaps(points[i], points[i] + 1000);
+        }
+    }
+
+    benchReport("linear scan overlap [p, p + 1s]", timer.seconds() * 1e6 / scans, "us");
+    benchReport("overlapping intervals per query", (double)found / scans, "intervals");
+    timer.reset();
+
+    for (long i = 0; i < queries; i++) {
+        overlapping(tree, points[i], points[i] + 1000, [&](const RBInterval<long>&) { found++; });
+    }
+
+    benchReport("tree overlap [p, p + 1s]", timer.seconds() * 1e6 / queries, "us");
+    timer.reset();
+
+    for (long i = 0; i < queries; i++) {
+        stabbing(tree, points[i], [&](const RBInterval<long>&) { found++; });
+    }
+
+    benchReport("tree stabbing p", timer.seconds() * 1e6 / queries, "us");
+    benchKeep(found);
+    return 0;
+}
@@ -0,0 +1,77 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Lookups and inserts of dense integer keys with the plain descent and with
+// jump tables of different sizes.
+// Usage: jump_table [keys] (100000000 needs about 5 GB)
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+using namespace std;
+
+void run(long amount, unsigned int bits) {
+    string name = (bits == 0) ? string("plain descent") : "jump table (" + to_string(bits) + " bits)";
+    mt19937 random(13);
+
+    //Even keys are in the tree, odd keys are inserted later
+    vector<int> keys(amount);
+
+    for (long i = 0; i < amount; i++) {
+        keys[i] = (int)(2 * i);
+    }
+
+    RBTree<int> tree;
+    tree.insert(keys.begin(), keys.end());
+
+    if (bits > 0) {
+        tree.setJumpTable(bits);
+    }
+
+    const long lookups = 2000000;
+    vector<int> probes(lookups);
+
+    for (long i = 0; i < lookups; i++) {
+        probes[i] = (int)(2 * (random() % amount));
+    }
+
+    //The first pass fills the buckets
+    size_t hits = 0;
+    for (long i = 0; i < lookups; i++) hits += tree.contains(probes[i]);
+
+    BenchTimer timer;
+
+    for (long i = 0; i < lookups; i++) {
+        hits += tree.contains(probes[i]);
+    }
+
+    benchReport(name + " contains", timer.seconds() * 1e9 / lookups, "ns");
+
+    for (long i = 0; i < lookups; i++) {
+        probes[i] = (int)(2 * (random() % amount) + 1);
+    }
+
+    timer.reset();
+
+    for (long i = 0; i < lookups; i++) {
+        hits += tree.insert(probes[i]);
+    }
+
+    benchReport(name + " insert", timer.seconds() * 1e9 / lookups, "ns");
+    benchKeep(hits);
+}
+
+int main(int argc, char** argv) {
+    long amount = benchArg(argc, argv, 1, 10000000);
+    unsigned int sizes[] = {0, 12, 16, 20};
+
+    for (unsigned int bits : sizes) {
+        run(amount, bits);
+    }
+
+    return 0;
+}
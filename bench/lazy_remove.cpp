@@ -0,0 +1,124 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Latency of single removes with eager and lazy removal and the memory of
+// the nodes that are kept until the compaction. The churn replaces every
+// removed key with a new one, so the automatic compaction runs meanwhile.
+// Usage: lazy_remove [keys]
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+#include "rbtree_lazy.h"
+using namespace std;
+
+void reportLatencies(const string& name, vector<double>& latencies) {
+    double total = 0;
+
+    for (size_t i = 0; i < latencies.size(); i++) {
+        total += latencies[i];
+    }
+
+    sort(latencies.begin(), latencies.end());
+    benchReport(name + " mean", total / latencies.size(), "ns");
+    benchReport(name + " p50", latencies[latencies.size() / 2], "ns");
+    benchReport(name + " p99", latencies[latencies.size() * 99 / 100], "ns");
+    benchReport(name + " p99.9", latencies[latencies.size() * 999 / 1000], "ns");
+    benchReport(name + " max", latencies.back() / 1000, "us");
+}
+
+template<typename Tree>
+void run(const string& name, Tree& tree, const vector<int>& removes, size_t nodes, size_t nodeSize) {
+    vector<double> latencies(removes.size());
+    size_t removed = 0;
+
+    for (size_t i = 0; i < removes.size(); i++) {
+        BenchTimer timer;
+        removed += tree.remove(removes[i]);
+        latencies[i] = timer.seconds() * 1e9;
+    }
+
+    benchKeep(removed);
+    reportLatencies(name + " remove", latencies);
+    benchReport(name + " memory per live key", (double)(nodes * nodeSize) / (removes.size()), "bytes");
+}
+
+//Every remove is followed by an insert of a new key
+template<typename Tree>
+void churn(const string& name, Tree& tree, const vector<int>& removes, int firstNew) {
+    vector<double> removeLatencies(removes.size());
+    vector<double> insertLatencies(removes.size());
+    size_t changed = 0;
+
+    for (size_t i = 0; i < removes.size(); i++) {
+        BenchTimer timer;
+        changed += tree.remove(removes[i]);
+        removeLatencies[i] = timer.seconds() * 1e9;
+
+        timer.reset();
+        changed += tree.insert(firstNew + (int)i);
+        insertLatencies[i] = timer.seconds() * 1e9;
+    }
+
+    benchKeep(changed);
+    reportLatencies(name + " churn remove", removeLatencies);
+    reportLatencies(name + " churn insert", insertLatencies);
+}
+
+int main(int argc, char** argv) {
+    long amount = benchArg(argc, argv, 1, 1000000);
+
+    mt19937 random(31);
+    vector<int> keys(amount);
+
+    for (long i = 0; i < amount; i++) keys[i] = (int)i;
+
+    shuffle(keys.begin(), keys.end(), random);
+
+    //Half of the keys are removed in random order
+    vector<int> removes(keys.begin(), keys.begin() + amount / 2);
+
+    {
+        RBTree<int> tree;
+        tree.insert(keys.begin(), keys.end());
+        run("eager", tree, removes, amount - removes.size(), RBTree<int>::nodeSize());
+    }
+
+    {
+        RBLazyTree<int> tree;
+        for (long i = 0; i < amount; i++) tree.insert(keys[i]);
+        run("lazy (ratio 0.25)", tree, removes, tree.size() + tree.dead(), RBLazyTree<int>::nodeSize());
+    }
+
+    {
+        //No automatic compaction, the dead nodes are removed afterwards
+        RBLazyTree<int> tree(1.0);
+        for (long i = 0; i < amount; i++) tree.insert(keys[i]);
+        run("lazy (manual)", tree, removes, tree.size() + tree.dead(), RBLazyTree<int>::nodeSize());
+
+        BenchTimer timer;
+        tree.compact();
+        benchReport("lazy (manual) compact", timer.seconds() * 1e3, "ms");
+    }
+
+    {
+        RBTree<int> tree;
+        tree.insert(keys.begin(), keys.end());
+        churn("eager", tree, removes, (int)amount);
+    }
+
+    {
+        //The compaction runs on the inserts while the removes only mark
+        RBLazyTree<int> tree;
+        for (long i = 0; i < amount; i++) tree.insert(keys[i]);
+        churn("lazy (ratio 0.25)", tree, removes, (int)amount);
+        benchReport("lazy (ratio 0.25) churn dead nodes", (double)tree.dead(), "");
+    }
+
+    return 0;
+}
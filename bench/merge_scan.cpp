@@ -0,0 +1,83 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Ordered scan over keys partitioned into several trees, merged by the merge
+// iterator and by concatenating and sorting the keys, and the cost of a seek.
+// Usage: merge_scan [keys]
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+#include "rbtree_merge.h"
+using namespace std;
+
+void run(long amount, int treeCount) {
+    mt19937 random(7);
+    vector<RBTree<int>> trees(treeCount);
+    vector<RBTree<int>*> pointers;
+
+    for (int i = 0; i < treeCount; i++) {
+        pointers.push_back(&trees[i]);
+    }
+
+    for (long i = 0; i < amount; i++) {
+        trees[random() % treeCount].insert((int)random());
+    }
+
+    string name = to_string(treeCount) + " trees";
+    BenchTimer timer;
+    long sum = 0;
+
+    for (RBMergeIterator<RBTree<int>> it(pointers); it; ++it) {
+        sum += *it;
+    }
+
+    benchReport(name + " merge iterator", timer.seconds() * 1e3, "ms");
+
+    timer.reset();
+    vector<int> keys;
+
+    for (int i = 0; i < treeCount; i++) {
+        keys.insert(keys.end(), trees[i].begin(), trees[i].end());
+    }
+
+    sort(keys.begin(), keys.end());
+
+    for (size_t i = 0; i < keys.size(); i++) {
+        sum += keys[i];
+    }
+
+    benchReport(name + " concatenate and sort", timer.seconds() * 1e3, "ms");
+
+    //Short range scans after a seek
+    RBMergeIterator<RBTree<int>> it(pointers);
+    const int seeks = 100000;
+    timer.reset();
+
+    for (int i = 0; i < seeks; i++) {
+        it.seek((int)random());
+
+        for (int j = 0; j < 10 && it; j++, ++it) {
+            sum += *it;
+        }
+    }
+
+    benchReport(name + " seek and 10 keys", timer.seconds() * 1e9 / seeks, "ns");
+    benchKeep(sum);
+}
+
+int main(int argc, char** argv) {
+    long amount = benchArg(argc, argv, 1, 1000000);
+    int counts[] = {1, 4, 16, 64};
+
+    for (int treeCount : counts) {
+        run(amount, treeCount);
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Comparison of two nearly identical trees with the Merkle hashes against
+// streaming both trees through their iterators.
+// Usage: merkle_diff [keys]
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+#include "rbtree_merkle.h"
+using namespace std;
+
+typedef RBMerkleTree<long> Tree;
+
+//Merge-like walk over both trees
+size_t streamDiff(Tree& first, Tree& second) {
+    Tree::iterator a = first.begin();
+    Tree::iterator b = second.begin();
+    size_t differences = 0;
+
+    while (a != first.end() || b != second.end()) {
+        if (b == second.end() || (a != first.end() && *a < *b)) {
+            differences++;
+            ++a;
+        } else if (a == first.end() || *b < *a) {
+            differences++;
+            ++b;
+        } else {
+            ++a;
+            ++b;
+        }
+    }
+
+    return differences;
+}
+
+int main(int argc, char** argv) {
+    long amount = benchArg(argc, argv, 1, 1000000);
+
+    //The replica gets the keys in a different order, so the shapes differ
+    vector<long> keys(amount);
+
+    for (long i = 0; i < amount; i++) {
+        keys[i] = i * 2;
+    }
+
+    Tree first;
+    first.assign_parallel(keys.begin(), keys.end());
+
+    mt19937 random(13);
+    shuffle(keys.begin(), keys.end(), random);
+    Tree replica;
+
+    for (long i = 0; i < amount; i++) {
+        replica.insert(keys[i]);
+    }
+
+    const long differences[] = {0, 1, 10, 100, 1000, 10000};
+    long applied = 0;
+
+    for (long target : differences) {
+        //New odd keys in the replica, a repeated key adds no difference
+        for (; applied < target; applied++) {
+            replica.insert((long)(random() % amount) * 2 + 1);
+        }
+
+        BenchTimer timer;
+        size_t found = 0;
+        diff(first, replica, [&](const long&, bool) { found++; });
+        double merkle = timer.seconds();
+
+        timer.reset();
+        size_t streamed = streamDiff(first, replica);
+        double stream = timer.seconds();
+
+        benchKeep(found + streamed);
+        string name = to_string(target) + " differences ";
+        benchReport(name + "merkle diff", merkle * 1e3, "ms");
+        benchReport(name + "iterator stream", stream * 1e3, "ms");
+    }
+
+    return 0;
+}
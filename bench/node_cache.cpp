@@ -0,0 +1,86 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Churn of many small trees (e.g. per-connection state) with and without
+// the node cache. Every round a thread destroys the trees that another
+// thread built in the previous round and builds new ones, so most nodes
+// are freed on a different thread than they were allocated on.
+// Usage: node_cache [trees per thread] [keys per tree] [threads] [rounds]
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+using namespace std;
+
+typedef RBTree<long> LongTree;
+
+double churn(long trees, long keys, unsigned int threads, long rounds) {
+    vector<vector<LongTree*>> built(threads);
+    BenchTimer timer;
+
+    for (long round = 0; round < rounds; round++) {
+        vector<thread> workers;
+
+        for (unsigned int t = 0; t < threads; t++) {
+            workers.push_back(thread([&built, trees, keys, threads, round, t]() {
+                vector<LongTree*>& owned = built[(t + round) % threads];
+                unsigned long state = (t + 1) * 2654435761UL + round;
+
+                for (size_t i = 0; i < owned.size(); i++) {
+                    delete owned[i];
+                }
+
+                owned.clear();
+
+                for (long i = 0; i < trees; i++) {
+                    LongTree* tree = new LongTree();
+
+                    for (long k = 0; k < keys; k++) {
+                        state = state * 6364136223846793005UL + 1442695040888963407UL;
+                        tree->insert((long)(state >> 33));
+                    }
+
+                    owned.push_back(tree);
+                }
+            }));
+        }
+
+        for (unsigned int t = 0; t < threads; t++) {
+            workers[t].join();
+        }
+    }
+
+    for (unsigned int t = 0; t < threads; t++) {
+        for (size_t i = 0; i < built[t].size(); i++) {
+            delete built[t][i];
+        }
+    }
+
+    return timer.seconds();
+}
+
+int main(int argc, char** argv) {
+    long trees = benchArg(argc, argv, 1, 10000);
+    long keys = benchArg(argc, argv, 2, 16);
+    unsigned int threads = (unsigned int)benchArg(argc, argv, 3, 16);
+    long rounds = benchArg(argc, argv, 4, 10);
+    double nodes = (double)trees * keys * threads * rounds;
+
+    LongTree::setNodeCache(0);
+    double plain = churn(trees, keys, threads, rounds);
+    benchReport("global allocator", plain * 1e3, "ms");
+    benchReport("  per node", plain * 1e9 / nodes, "ns");
+
+    //Enough batches for the nodes of about one thread
+    LongTree::setNodeCache((size_t)(trees * keys / 32 + 1));
+    double cached = churn(trees, keys, threads, rounds);
+    benchReport("node cache", cached * 1e3, "ms");
+    benchReport("  per node", cached * 1e9 / nodes, "ns");
+    benchReport("  speedup", plain / cached, "x");
+
+    benchReport("hardware threads", std::thread::hardware_concurrency(), "");
+    return 0;
+}
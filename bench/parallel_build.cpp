@@ -0,0 +1,57 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Loading an unsorted dump with an insert loop against assign_parallel.
+// Usage: parallel_build [keys] [max threads]
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+using namespace std;
+
+typedef RBTree<long> LongTree;
+
+int main(int argc, char** argv) {
+    long amount = benchArg(argc, argv, 1, 10000000);
+    unsigned int maxThreads = (unsigned int)benchArg(argc, argv, 2, 
+        std::max(8u, std::thread::hardware_concurrency()));
+
+    //Unsorted dump with about 10% duplicates
+    mt19937_64 random(42);
+    vector<long> dump(amount);
+
+    for (long i = 0; i < amount; i++) {
+        dump[i] = (long)(random() % (amount * 10));
+    }
+
+    BenchTimer timer;
+    LongTree inserted;
+
+    for (long i = 0; i < amount; i++) {
+        inserted.insert(dump[i]);
+    }
+
+    double serial = timer.seconds();
+    benchReport("insert loop", serial * 1e3, "ms");
+    inserted.clear();
+
+    for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+        LongTree tree;
+
+        timer.reset();
+        tree.assign_parallel(dump.begin(), dump.end(), threads);
+        double seconds = timer.seconds();
+
+        string name = "assign_parallel, " + to_string(threads) + " threads";
+        benchReport(name, seconds * 1e3, "ms");
+        benchReport("  speedup over insert loop", serial / seconds, "x");
+    }
+
+    benchReport("hardware threads", std::thread::hardware_concurrency(), "");
+    return 0;
+}
@@ -0,0 +1,52 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Scaling of parallel_reduce against the sequential iterator.
+// Usage: parallel_scan [keys] [max threads]
+// The nightly export size is 100M keys: parallel_scan 100000000
+#include <algorithm>
+#include <thread>
+
+#include "bench.h"
+#include "rbtree.h"
+using namespace std;
+
+typedef RBTree<long> LongTree;
+
+int main(int argc, char** argv) {
+    long amount = benchArg(argc, argv, 1, 10000000);
+    unsigned int maxThreads = (unsigned int)benchArg(argc, argv, 2, 
+        std::max(8u, std::thread::hardware_concurrency()));
+
+    LongTree tree;
+    for (long i = 0; i < amount; i++) {
+        tree.insert(i);
+    }
+
+    BenchTimer timer;
+    long sum = 0;
+
+    for (LongTree::iterator it = tree.begin(); it != tree.end(); ++it) {
+        sum += *it;
+    }
+
+    double sequential = timer.seconds();
+    benchKeep(sum);
+    benchReport("iterator sum", sequential * 1e3, "ms");
+
+    for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+        timer.reset();
+        sum = tree.parallel_reduce(0L, std::plus<long>(), std::plus<long>(), threads);
+        double seconds = timer.seconds();
+        benchKeep(sum);
+
+        string name = "parallel_reduce sum, " + to_string(threads) + " threads";
+        benchReport(name, seconds * 1e3, "ms");
+        benchReport("  speedup over iterator", sequential / seconds, "x");
+    }
+
+    benchReport("hardware threads", std::thread::hardware_concurrency(), "");
+    return 0;
+}
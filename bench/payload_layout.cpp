@@ -0,0 +1,110 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Lookups in maps with 8 and 256 byte values, stored inside the nodes and
+// stored in a slab next to compact nodes.
+// Usage: payload_layout [keys]
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+#include "rbtree_slab.h"
+using namespace std;
+
+template<size_t Size>
+struct Payload {
+    char bytes[Size];
+
+    explicit Payload(int seed) { memset(bytes, seed, Size); }
+};
+
+//Key and value inside of the node
+template<size_t Size>
+struct InlineEntry {
+    int key;
+    Payload<Size> value;
+
+    InlineEntry(int key, const Payload<Size>& value) : key(key), value(value) {}
+};
+
+template<size_t Size>
+struct InlineLess {
+    typedef void is_transparent;
+
+    inline bool operator() (const InlineEntry<Size>& a, const InlineEntry<Size>& b) const { return a.key < b.key; }
+    inline bool operator() (const InlineEntry<Size>& a, int b) const { return a.key < b; }
+    inline bool operator() (int a, const InlineEntry<Size>& b) const { return a < b.key; }
+};
+
+template<size_t Size>
+void run(const vector<int>& keys, const vector<int>& probes) {
+    string size = to_string(Size) + " byte values";
+    RBTree<InlineEntry<Size>, InlineLess<Size>> inlined;
+    RBSlabMap<int, Payload<Size>> split;
+
+    //Filled one after the other, so the nodes of the maps are not interleaved
+    for (size_t i = 0; i < keys.size(); i++) {
+        inlined.insert(InlineEntry<Size>(keys[i], Payload<Size>(keys[i])));
+    }
+
+    for (size_t i = 0; i < keys.size(); i++) {
+        split.insert(keys[i], Payload<Size>(keys[i]));
+    }
+
+    size_t sum = 0;
+    BenchTimer timer;
+
+    for (size_t i = 0; i < probes.size(); i++) {
+        sum += inlined.contains(probes[i]);
+    }
+
+    benchReport("inline " + size + " contains", timer.seconds() * 1e9 / probes.size(), "ns");
+    timer.reset();
+
+    for (size_t i = 0; i < probes.size(); i++) {
+        sum += split.contains(probes[i]);
+    }
+
+    benchReport("slab " + size + " contains", timer.seconds() * 1e9 / probes.size(), "ns");
+
+    //A lookup that reads the value
+    timer.reset();
+
+    for (size_t i = 0; i < probes.size(); i++) {
+        sum += inlined.find(probes[i])->value.bytes[0];
+    }
+
+    benchReport("inline " + size + " find and read", timer.seconds() * 1e9 / probes.size(), "ns");
+    timer.reset();
+
+    for (size_t i = 0; i < probes.size(); i++) {
+        sum += split.find(probes[i])->bytes[0];
+    }
+
+    benchReport("slab " + size + " find and read", timer.seconds() * 1e9 / probes.size(), "ns");
+    benchKeep(sum);
+}
+
+int main(int argc, char** argv) {
+    long amount = benchArg(argc, argv, 1, 1000000);
+
+    mt19937 random(5);
+    vector<int> keys(amount);
+    vector<int> probes(2000000);
+
+    for (long i = 0; i < amount; i++) keys[i] = (int)i;
+
+    shuffle(keys.begin(), keys.end(), random);
+
+    for (size_t i = 0; i < probes.size(); i++) probes[i] = (int)(random() % amount);
+
+    run<8>(keys, probes);
+    run<256>(keys, probes);
+    return 0;
+}
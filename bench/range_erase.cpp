@@ -0,0 +1,95 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Range erase and predicate erase against removing key by key.
+// Usage: range_erase [keys]
+#include <algorithm>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+using namespace std;
+
+typedef RBTree<int> IntTree;
+
+//Both trees are filled in lockstep, so that their nodes have the same locality
+void fill(IntTree& first, IntTree& second, const vector<int>& keys) {
+    for (size_t i = 0; i < keys.size(); i++) {
+        first.insert(keys[i]);
+        second.insert(keys[i]);
+    }
+}
+
+void benchErase(const vector<int>& keys, const string& order) {
+    int amount = (int)keys.size();
+
+    //Drop all keys below a cutoff like expiring old timestamps
+    const int fractions[] = {1, 10, 50};
+
+    for (int f = 0; f < 3; f++) {
+        int cutoff = (int)((long)amount * fractions[f] / 100);
+        string label = to_string(fractions[f]) + "% prefix, " + order;
+
+        IntTree loopTree;
+        IntTree rangeTree;
+        fill(loopTree, rangeTree, keys);
+        BenchTimer timer;
+
+        for (int key = 0; key < cutoff; key++) {
+            loopTree.remove(key);
+        }
+
+        benchReport("remove loop " + label, timer.seconds() * 1e3, "ms");
+
+        timer.reset();
+
+        size_t removed = rangeTree.erase_range(0, cutoff);
+
+        benchReport("erase_range " + label, timer.seconds() * 1e3, "ms");
+        benchKeep(removed);
+    }
+
+    //Remove every second key, the keys have to be found with a scan first
+    IntTree loopTree;
+    IntTree predicateTree;
+    fill(loopTree, predicateTree, keys);
+    BenchTimer timer;
+
+    vector<int> matches;
+    for (IntTree::iterator it = loopTree.begin(); it != loopTree.end(); ++it) {
+        if (*it % 2 == 1) {
+            matches.push_back(*it);
+        }
+    }
+
+    for (size_t i = 0; i < matches.size(); i++) {
+        loopTree.remove(matches[i]);
+    }
+
+    benchReport("scan and remove loop odd keys, " + order, timer.seconds() * 1e3, "ms");
+
+    timer.reset();
+
+    size_t removed = predicateTree.erase_if([](int key) { return key % 2 == 1; });
+
+    benchReport("erase_if odd keys, " + order, timer.seconds() * 1e3, "ms");
+    benchKeep(removed);
+}
+
+int main(int argc, char** argv) {
+    int amount = (int)benchArg(argc, argv, 1, 1000000);
+    vector<int> keys(amount);
+
+    for (int i = 0; i < amount; i++) {
+        keys[i] = i;
+    }
+
+    //Ascending inserts like timestamps and random inserts without locality
+    benchErase(keys, "ascending");
+
+    random_shuffle(keys.begin(), keys.end());
+    benchErase(keys, "random");
+    return 0;
+}
@@ -0,0 +1,130 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Memory per key and lookup time of std::string keys against RBStringKey
+// on a generated URL corpus.
+// Usage: string_keys [keys] [lookups]
+#include <algorithm>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+#include "rbtree_string.h"
+using namespace std;
+
+//Live heap bytes including the allocator rounding (glibc)
+static size_t liveBytes = 0;
+
+void* operator new(size_t size) {
+    void* memory = malloc(size);
+
+    if (memory == NULL) {
+        throw bad_alloc();
+    }
+
+    liveBytes += malloc_usable_size(memory);
+    return memory;
+}
+
+//Not inlined, GCC would otherwise pair the free with new[] of the keys
+__attribute__((noinline)) void operator delete(void* memory) noexcept {
+    liveBytes -= malloc_usable_size(memory);
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    operator delete(memory);
+}
+
+
+//URLs with a few schemes and hosts and paths of different depth
+vector<string> urlCorpus(long amount) {
+    static const char* hosts[] = {
+        "www.example.com", "news.example.org", "shop.example.net", "docs.example.io",
+        "cdn.static-files.com", "api.service.dev", "blog.personal.me", "www.wikipedia.org"
+    };
+    static const char* words[] = {
+        "index", "article", "product", "category", "user", "images", "2017", "search",
+        "red", "black", "tree", "v1", "list", "item", "about", "help"
+    };
+
+    mt19937 random(11);
+    vector<string> urls;
+    urls.reserve(amount);
+
+    for (long i = 0; i < amount; i++) {
+        string url = (random() % 10 == 0) ? "http://" : "https://";
+        url += hosts[random() % 8];
+
+        int depth = 1 + random() % 4;
+
+        for (int d = 0; d < depth; d++) {
+            url += "/";
+            url += words[random() % 16];
+        }
+
+        url += "/" + to_string(random() % 100000);
+
+        if (random() % 3 == 0) {
+            url += "?id=" + to_string(random() % 1000);
+        }
+
+        urls.push_back(url);
+    }
+
+    return urls;
+}
+
+template<typename Tree>
+void run(const string& name, const vector<string>& urls, const vector<string>& probes) {
+    size_t before = liveBytes;
+    Tree* tree = new Tree();
+    size_t keys = 0;
+
+    for (size_t i = 0; i < urls.size(); i++) {
+        keys += tree->insert(urls[i]);
+    }
+
+    benchReport(name + " bytes/key", (double)(liveBytes - before) / keys, "bytes");
+
+    BenchTimer timer;
+    size_t hits = 0;
+
+    for (size_t i = 0; i < probes.size(); i++) {
+        hits += tree->contains(probes[i]);
+    }
+
+    double seconds = timer.seconds();
+    benchKeep(hits);
+    benchReport(name + " lookup", seconds * 1e9 / probes.size(), "ns");
+    delete tree;
+}
+
+int main(int argc, char** argv) {
+    long amount = benchArg(argc, argv, 1, 500000);
+    long lookups = benchArg(argc, argv, 2, 1000000);
+
+    vector<string> urls = urlCorpus(amount);
+    vector<string> probes(lookups);
+
+    for (long i = 0; i < lookups; i++) {
+        probes[i] = urls[(i * 7919) % amount];
+    }
+
+    size_t length = 0;
+    for (long i = 0; i < amount; i++) {
+        length += urls[i].size();
+    }
+
+    benchReport("average URL length", (double)length / amount, "chars");
+    run<RBTree<string, less<>>>("std::string", urls, probes);
+    run<RBStringTree<>>("RBStringKey", urls, probes);
+    return 0;
+}
@@ -0,0 +1,61 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Time the owning thread spends in clear() with and without deferred
+// destruction.
+// Usage: teardown [keys]
+#include <algorithm>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+using namespace std;
+
+typedef RBTree<int> IntTree;
+
+void fill(IntTree& tree, const vector<int>& keys) {
+    for (size_t i = 0; i < keys.size(); i++) {
+        tree.insert(keys[i]);
+    }
+}
+
+int main(int argc, char** argv) {
+    int amount = (int)benchArg(argc, argv, 1, 2000000);
+    vector<int> keys(amount);
+
+    for (int i = 0; i < amount; i++) {
+        keys[i] = i;
+    }
+
+    random_shuffle(keys.begin(), keys.end());
+
+    IntTree tree;
+    fill(tree, keys);
+
+    BenchTimer timer;
+    tree.clear();
+    benchReport("clear", timer.seconds() * 1e3, "ms");
+
+    //A cloned tree is freed block by block
+    fill(tree, keys);
+    IntTree cloned(tree);
+    tree.clear();
+
+    timer.reset();
+    cloned.clear();
+    benchReport("clear (cloned tree)", timer.seconds() * 1e3, "ms");
+
+    IntTree deferred;
+    deferred.setDeferredDestruction(true);
+    fill(deferred, keys);
+
+    timer.reset();
+    deferred.clear();
+    benchReport("clear (deferred, owning thread)", timer.seconds() * 1e6, "us");
+
+    RBTreeReclaimer::instance().wait();
+    benchReport("clear (deferred, until freed)", timer.seconds() * 1e3, "ms");
+    return 0;
+}
@@ -0,0 +1,89 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Full scans and short range scans with the parent pointer iterator
+// against the in-order links of a threaded tree, and the node sizes.
+// Usage: threaded_scan [keys] [range scans] [range length]
+#include <algorithm>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+using namespace std;
+
+template<typename Tree>
+long fullScan(Tree& tree) {
+    long sum = 0;
+
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+        sum += *it;
+    }
+
+    return sum;
+}
+
+template<typename Tree>
+long rangeScans(Tree& tree, const vector<int>& starts, int length) {
+    long sum = 0;
+
+    for (size_t i = 0; i < starts.size(); i++) {
+        typename Tree::iterator it = tree.lower_bound(starts[i]);
+
+        for (int k = 0; k < length && it != tree.end(); k++, ++it) {
+            sum += *it;
+        }
+    }
+
+    return sum;
+}
+
+int main(int argc, char** argv) {
+    int amount = (int)benchArg(argc, argv, 1, 2000000);
+    int scans = (int)benchArg(argc, argv, 2, 1000000);
+    int length = (int)benchArg(argc, argv, 3, 16);
+    vector<int> keys(amount);
+
+    for (int i = 0; i < amount; i++) {
+        keys[i] = i;
+    }
+
+    random_shuffle(keys.begin(), keys.end());
+
+    //Both trees are filled in lockstep, so their nodes are equally scattered
+    RBTree<int> plain;
+    RBThreadedTree<int> threaded;
+
+    for (int i = 0; i < amount; i++) {
+        plain.insert(keys[i]);
+        threaded.insert(keys[i]);
+    }
+
+    vector<int> starts(scans);
+    for (int i = 0; i < scans; i++) {
+        starts[i] = rand() % amount;
+    }
+
+    BenchTimer timer;
+    benchKeep(fullScan(plain));
+    benchReport("full scan (parent pointers)", timer.seconds() * 1e3, "ms");
+
+    timer.reset();
+    benchKeep(fullScan(threaded));
+    benchReport("full scan (threaded)", timer.seconds() * 1e3, "ms");
+
+    timer.reset();
+    benchKeep(rangeScans(plain, starts, length));
+    benchReport("range scans (parent pointers)", timer.seconds() * 1e3, "ms");
+
+    timer.reset();
+    benchKeep(rangeScans(threaded, starts, length));
+    benchReport("range scans (threaded)", timer.seconds() * 1e3, "ms");
+
+    //The in-order list costs two pointers per node
+    benchReport("node size (parent pointers)", RBTree<int>::nodeSize(), "bytes");
+    benchReport("node size (threaded)", RBThreadedTree<int>::nodeSize(), "bytes");
+    benchReport("  list links per node", (double)(RBThreadedTree<int>::nodeSize() - RBTree<int>::nodeSize()), "bytes");
+    return 0;
+}
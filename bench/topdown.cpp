@@ -0,0 +1,80 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Bottom-up RBTree against the parent-free top-down RBTopDownTree.
+// Usage: topdown [keys]
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+#include "rbtree_topdown.h"
+using namespace std;
+
+//The tree type is the balancing policy
+template<typename Tree>
+void run(const string& name, const vector<int>& inserts, const vector<int>& lookups, const vector<int>& removes) {
+    Tree tree;
+    BenchTimer timer;
+
+    for (size_t i = 0; i < inserts.size(); i++) {
+        tree.insert(inserts[i]);
+    }
+
+    benchReport(name + " insert", timer.seconds() * 1e3, "ms");
+
+    timer.reset();
+    long hits = 0;
+
+    for (size_t i = 0; i < lookups.size(); i++) {
+        hits += tree.contains(lookups[i]);
+    }
+
+    benchKeep(hits);
+    benchReport(name + " lookup", timer.seconds() * 1e3, "ms");
+
+    timer.reset();
+    long sum = 0;
+
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+        sum += *it;
+    }
+
+    benchKeep(sum);
+    benchReport(name + " full scan", timer.seconds() * 1e3, "ms");
+
+    timer.reset();
+
+    for (size_t i = 0; i < removes.size(); i++) {
+        tree.remove(removes[i]);
+    }
+
+    benchReport(name + " remove", timer.seconds() * 1e3, "ms");
+}
+
+int main(int argc, char** argv) {
+    int amount = (int)benchArg(argc, argv, 1, 1000000);
+    vector<int> inserts(amount);
+
+    for (int i = 0; i < amount; i++) {
+        inserts[i] = i;
+    }
+
+    random_shuffle(inserts.begin(), inserts.end());
+    vector<int> lookups(inserts);
+    random_shuffle(lookups.begin(), lookups.end());
+    vector<int> removes(inserts);
+    random_shuffle(removes.begin(), removes.end());
+
+    benchReport("bottom-up node size", RBTree<int>::nodeSize(), "bytes");
+    benchReport("top-down node size", RBTopDownTree<int>::nodeSize(), "bytes");
+    benchReport("bottom-up node size (64 bit keys)", RBTree<long>::nodeSize(), "bytes");
+    benchReport("top-down node size (64 bit keys)", RBTopDownTree<long>::nodeSize(), "bytes");
+
+    run<RBTree<int>>("bottom-up", inserts, lookups, removes);
+    run<RBTopDownTree<int>>("top-down", inserts, lookups, removes);
+    return 0;
+}
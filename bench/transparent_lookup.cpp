@@ -0,0 +1,111 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Allocations and time per lookup with and without a transparent comparator.
+// Usage: transparent_lookup [keys] [lookups]
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+using namespace std;
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* memory = malloc(size);
+
+    if (memory == NULL) {
+        throw bad_alloc();
+    }
+
+    return memory;
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+//Length aware key reference (std::string_view is not available in C++14)
+struct StringRef {
+    const char* data;
+    size_t size;
+};
+
+struct StringRefLess {
+    typedef void is_transparent;
+
+    static inline int compare(const char* a, size_t aSize, const char* b, size_t bSize) {
+        int result = memcmp(a, b, min(aSize, bSize));
+        return (result != 0) ? result : (aSize < bSize ? -1 : (aSize > bSize ? 1 : 0));
+    }
+
+    inline bool operator() (const string& a, const string& b) const { return a < b; }
+    inline bool operator() (const string& a, const StringRef& b) const {
+        return compare(a.data(), a.size(), b.data, b.size) < 0;
+    }
+    inline bool operator() (const StringRef& a, const string& b) const {
+        return compare(a.data, a.size, b.data(), b.size()) < 0;
+    }
+};
+
+template<typename Tree, typename Probe>
+void benchLookups(const string& name, Tree& tree, const vector<Probe>& probes) {
+    size_t hits = 0;
+    size_t before = allocations;
+    BenchTimer timer;
+
+    for (size_t i = 0; i < probes.size(); i++) {
+        hits += tree.contains(probes[i]);
+    }
+
+    double elapsed = timer.seconds();
+    benchKeep(hits);
+
+    benchReport(name + " allocations/lookup", (double)(allocations - before) / probes.size(), "");
+    benchReport(name + " time/lookup", elapsed * 1e9 / probes.size(), "ns");
+}
+
+int main(int argc, char** argv) {
+    long keys = benchArg(argc, argv, 1, 100000);
+    long lookups = benchArg(argc, argv, 2, 1000000);
+
+    //Keys are longer than the small string buffer so every std::string allocates
+    vector<string> corpus;
+    for (long i = 0; i < 2 * keys; i++) {
+        corpus.push_back("https://example.org/resource/" + to_string(i * 7919));
+    }
+
+    RBTree<string> plainTree;
+    RBTree<string, less<>> transparentTree;
+    RBTree<string, StringRefLess> refTree;
+
+    for (long i = 0; i < keys; i++) {
+        plainTree.insert(corpus[i]);
+        transparentTree.insert(corpus[i]);
+        refTree.insert(corpus[i]);
+    }
+
+    //Half of the probes hit, the other half miss
+    vector<const char*> probes;
+    vector<StringRef> refProbes;
+    for (long i = 0; i < lookups; i++) {
+        const string& key = corpus[(i * 31) % corpus.size()];
+        probes.push_back(key.c_str());
+        refProbes.push_back({key.data(), key.size()});
+    }
+
+    benchLookups("RBTree<string> (const char*)", plainTree, probes);
+    benchLookups("RBTree<string, less<>> (const char*)", transparentTree, probes);
+    benchLookups("RBTree<string, StringRefLess>", refTree, refProbes);
+    return 0;
+}
@@ -0,0 +1,93 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+// Lookups with Zipfian key popularity with and without the hot-key cache
+// for different skews.
+// Usage: zipf_cache [keys] [lookups]
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "rbtree.h"
+#include "rbtree_cache.h"
+using namespace std;
+
+//Keys drawn with probability proportional to 1 / rank^skew
+vector<int> zipfProbes(const vector<int>& keys, double skew, long lookups, mt19937& random) {
+    vector<double> cumulative(keys.size());
+    double sum = 0;
+
+    for (size_t i = 0; i < keys.size(); i++) {
+        sum += 1.0 / pow((double)(i + 1), skew);
+        cumulative[i] = sum;
+    }
+
+    uniform_real_distribution<double> uniform(0, sum);
+    vector<int> probes(lookups);
+
+    for (long i = 0; i < lookups; i++) {
+        size_t rank = lower_bound(cumulative.begin(), cumulative.end(), uniform(random)) - cumulative.begin();
+        probes[i] = keys[min(rank, keys.size() - 1)];
+    }
+
+    return probes;
+}
+
+template<typename Tree>
+double lookupTime(Tree& tree, const vector<int>& probes) {
+    BenchTimer timer;
+    size_t hits = 0;
+
+    for (size_t i = 0; i < probes.size(); i++) {
+        hits += tree.contains(probes[i]);
+    }
+
+    double seconds = timer.seconds();
+    benchKeep(hits);
+    return seconds * 1e9 / probes.size();
+}
+
+int main(int argc, char** argv) {
+    long amount = benchArg(argc, argv, 1, 1000000);
+    long lookups = benchArg(argc, argv, 2, 2000000);
+
+    //The popularity rank is independent of the key order
+    vector<int> keys(amount);
+
+    for (long i = 0; i < amount; i++) {
+        keys[i] = (int)i;
+    }
+
+    mt19937 random(3);
+    shuffle(keys.begin(), keys.end(), random);
+
+    RBTree<int> plain;
+    RBCachedTree<int> cached;
+    RBCachedTree<int> large(4096);
+
+    for (long i = 0; i < amount; i++) {
+        plain.insert(keys[i]);
+        cached.insert(keys[i]);
+        large.insert(keys[i]);
+    }
+
+    const double skews[] = {0.0, 0.8, 0.99, 1.2};
+
+    for (double skew : skews) {
+        vector<int> probes = zipfProbes(keys, skew, lookups, random);
+        string name = "skew " + to_string(skew).substr(0, 4) + " ";
+
+        benchReport(name + "tree", lookupTime(plain, probes), "ns");
+        benchReport(name + "cached tree (" + to_string(cached.slotCount()) + " slots)",
+                    lookupTime(cached, probes), "ns");
+        benchReport(name + "cached tree (" + to_string(large.slotCount()) + " slots)",
+                    lookupTime(large, probes), "ns");
+    }
+
+    return 0;
+}
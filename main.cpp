@@ -6,12 +6,28 @@
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 #ifndef DEBUG
 #define DEBUG
 #endif
 
 #include "rbtree.h"
+#include "rbtree_buffer.h"
+#include "rbtree_cache.h"
+#include "rbtree_combining.h"
+#include "rbtree_filter.h"
+#include "rbtree_interval.h"
+#include "rbtree_lazy.h"
+#include "rbtree_merge.h"
+#include "rbtree_merkle.h"
+#include "rbtree_slab.h"
+#include "rbtree_static.h"
+#include "rbtree_string.h"
+#include "rbtree_topdown.h"
 using namespace std;
 
 #define TestPassed {return true;}
@@ -25,6 +41,16 @@ using namespace std;
 #define AssertFalse(x) ({if(x) {return false;}})
 
 typedef RBTree<int> IntTree;
+typedef RBTree<string, less<>> StringTree;
+typedef RBMultiTree<int> IntMultiTree;
+typedef RBThreadedTree<int> IntThreadedTree;
+typedef RBTopDownTree<int> IntTopDownTree;
+typedef RBFilteredTree<int> IntFilteredTree;
+typedef RBCachedTree<int> IntCachedTree;
+typedef RBIntervalTree<int> IntIntervalTree;
+typedef RBMerkleTree<int> IntMerkleTree;
+typedef RBBufferedTree<int> IntBufferedTree;
+typedef RBLazyTree<int> IntLazyTree;
 typedef enum TestResult {
     SUCCESS = 0,
     FAILED = 1,
@@ -183,6 +209,1313 @@ bool randomIterate(int amount) {
     TestPassed;
 }
 
+bool randomStringRemove(int amount) {
+    StringTree* tree = new StringTree();
+    vector<string> numbers(amount);
+    
+    for (int i = 0; i < amount; i++) {
+        numbers[i] = "key-" + to_string(i);
+    }
+    
+    random_shuffle(numbers.begin(), numbers.end());
+
+    for (int i = 0; i < amount; i++) {
+        tree->insert(numbers[i]);
+    }
+
+    random_shuffle(numbers.begin(), numbers.end());
+
+    for (int i = 0; i < amount; i++) {
+        AssertTrue(tree->remove(numbers[i].c_str()));
+        AssertTrue(tree->invariant());
+        AssertFalse(tree->contains(numbers[i].c_str()));
+    }
+
+    delete tree;
+    TestPassed;
+}
+
+bool randomMultiset(int amount) {
+    IntMultiTree* tree = new IntMultiTree();
+    int counts[amount];
+    
+    for (int i = 0; i < amount; i++) {
+        counts[i] = 0;
+    }
+
+    //Insert and remove random keys and compare with the expected counts
+    for (int i = 0; i < amount * 10; i++) {
+        int key = rand() % amount;
+
+        if (rand() % 3 == 0) {
+            AssertEquals((counts[key] > 0), tree->remove(key));
+            counts[key] -= (counts[key] > 0);
+        } else {
+            AssertTrue(tree->insert(key));
+            counts[key]++;
+        }
+    }
+
+    AssertTrue(tree->invariant());
+
+    int total = 0;
+
+    for (int i = 0; i < amount; i++) {
+        AssertEquals((unsigned int)counts[i], tree->count(i));
+        total += counts[i];
+    }
+
+    int elemCount = 0;
+    int previous = -1;
+
+    for (IntMultiTree::iterator it = tree->begin(); it != tree->end(); ++it) {
+        AssertTrue((previous <= *it));
+        previous = *it;
+        elemCount++;
+    }
+
+    AssertEquals(total, elemCount);
+
+    delete tree;
+    TestPassed;
+}
+
+bool randomRangeErase(int amount) {
+    IntTree* tree = new IntTree();
+    bool exp[amount];
+    int numbers[amount];
+    
+    for (int i = 0; i < amount; i++) {
+        numbers[i] = i;
+        exp[i] = true;
+    }
+    
+    random_shuffle(numbers, numbers+amount);
+
+    for (int i = 0; i < amount; i++) {
+        tree->insert(numbers[i]);
+    }
+
+    //Erase random ranges and compare with the expected keys
+    for (int i = 0; i < 20; i++) {
+        int from = rand() % amount;
+        int to = from + rand() % (amount / 10 + 1);
+        size_t expRemoved = 0;
+
+        for (int j = from; j < to && j < amount; j++) {
+            expRemoved += exp[j];
+            exp[j] = false;
+        }
+
+        AssertEquals(expRemoved, tree->erase_range(from, to));
+        AssertTrue(tree->invariant());
+    }
+
+    for (int i = 0; i < amount; i++) {
+        AssertEquals(exp[i], tree->contains(i));
+    }
+
+    delete tree;
+    TestPassed;
+}
+
+bool randomExtract(int amount) {
+    IntTree* pending = new IntTree();
+    IntTree* active = new IntTree();
+    int numbers[amount];
+    
+    for (int i = 0; i < amount; i++) {
+        numbers[i] = i;
+    }
+    
+    random_shuffle(numbers, numbers+amount);
+
+    for (int i = 0; i < amount; i++) {
+        pending->insert(numbers[i]);
+    }
+
+    random_shuffle(numbers, numbers+amount);
+
+    //Move every key from the pending to the active tree
+    for (int i = 0; i < amount; i++) {
+        IntTree::node_type handle = pending->extract(numbers[i]);
+        AssertFalse(handle.empty());
+        AssertEquals(numbers[i], handle.value());
+
+        const int* address = &handle.value();
+        AssertTrue(active->insert(std::move(handle)));
+        AssertTrue(handle.empty());
+        AssertTrue((address == &*active->find(numbers[i])));
+
+        AssertTrue(pending->invariant());
+        AssertTrue(active->invariant());
+        AssertFalse(pending->contains(numbers[i]));
+    }
+
+    for (int i = 0; i < amount; i++) {
+        AssertTrue(active->contains(i));
+    }
+
+    delete pending;
+    delete active;
+    TestPassed;
+}
+
+bool randomClone(int amount) {
+    IntTree* tree = new IntTree();
+    int numbers[amount];
+    
+    for (int i = 0; i < amount; i++) {
+        numbers[i] = i;
+    }
+    
+    random_shuffle(numbers, numbers+amount);
+
+    for (int i = 0; i < amount; i++) {
+        tree->insert(numbers[i]);
+    }
+
+    IntTree* copy = new IntTree(*tree);
+    AssertTrue(copy->invariant());
+    AssertEquals(tree->toString(), copy->toString());
+    delete tree;
+
+    //Cloned nodes can be removed one by one
+    random_shuffle(numbers, numbers+amount);
+
+    for (int i = 0; i < amount; i++) {
+        AssertTrue(copy->remove(numbers[i]));
+        AssertTrue(copy->invariant());
+    }
+
+    delete copy;
+    TestPassed;
+}
+
+bool randomParallelBuild(int amount, unsigned int threads) {
+    IntTree* tree = new IntTree();
+    vector<int> keys;
+
+    //Every key is contained twice
+    for (int i = 0; i < amount; i++) {
+        keys.push_back(i / 2);
+    }
+
+    random_shuffle(keys.begin(), keys.end());
+    tree->assign_parallel(keys.begin(), keys.end(), threads);
+    AssertTrue(tree->invariant());
+
+    int expected = 0;
+
+    for (IntTree::iterator it = tree->begin(); it != tree->end(); ++it) {
+        AssertEquals(expected++, *it);
+    }
+
+    AssertEquals(amount / 2, expected);
+
+    //The built tree is repaired like any other tree
+    random_shuffle(keys.begin(), keys.end());
+
+    for (int i = 0; i < amount; i += 3) {
+        tree->remove(keys[i]);
+        AssertTrue(tree->invariant());
+    }
+
+    delete tree;
+    TestPassed;
+}
+
+bool randomThreaded(int amount) {
+    IntThreadedTree* tree = new IntThreadedTree();
+    IntThreadedTree* other = new IntThreadedTree();
+    bool exp[amount];
+
+    for (int i = 0; i < amount; i++) {
+        exp[i] = false;
+    }
+
+    //Every operation that changes the tree has to keep the in-order links
+    for (int i = 0; i < amount * 2; i++) {
+        int key = rand() % amount;
+
+        switch (rand() % 6) {
+            case 0:
+            case 1:
+                exp[key] |= tree->insert(key);
+                break;
+            case 2:
+                if (tree->remove(key)) exp[key] = false;
+                break;
+            case 3:
+                tree->erase_range(key, key + rand() % 20);
+                for (int j = key; j < key + 20 && j < amount; j++) exp[j] = tree->contains(j);
+                break;
+            case 4:
+                if (tree->contains(key)) {
+                    IntThreadedTree::node_type handle = tree->extract(key);
+                    AssertTrue(tree->invariant());
+                    other->insert(std::move(handle));
+                    exp[key] = false;
+                }
+                break;
+            case 5:
+                if (rand() % 50 == 0) {
+                    tree->merge(*other);
+                    for (int j = 0; j < amount; j++) exp[j] = tree->contains(j);
+                }
+                break;
+        }
+
+        AssertTrue(tree->invariant());
+        AssertTrue(other->invariant());
+    }
+
+    tree->erase_if([](int key) { return key % 7 == 0; });
+    AssertTrue(tree->invariant());
+
+    IntThreadedTree copy(*tree);
+    AssertTrue(copy.invariant());
+
+    //Walk forwards and backwards through the links
+    IntThreadedTree::iterator last = copy.end();
+    int expected = 0;
+
+    for (IntThreadedTree::iterator it = copy.begin(); it != copy.end(); ++it) {
+        while (!exp[expected] || expected % 7 == 0) expected++;
+        AssertEquals(expected, *it);
+        expected++;
+        last = it;
+    }
+
+    for (IntThreadedTree::iterator it = last; it != copy.end(); --it) {
+        expected--;
+        while (!exp[expected] || expected % 7 == 0) expected--;
+        AssertEquals(expected, *it);
+    }
+
+    delete tree;
+    delete other;
+    TestPassed;
+}
+
+bool randomTopDown(int amount) {
+    IntTopDownTree* tree = new IntTopDownTree();
+    int numbers[amount];
+
+    for (int i = 0; i < amount; i++) {
+        numbers[i] = i;
+    }
+
+    random_shuffle(numbers, numbers+amount);
+
+    for (int i = 0; i < amount; i++) {
+        AssertTrue(tree->insert(numbers[i]));
+        AssertFalse(tree->insert(numbers[i]));
+        AssertTrue(tree->invariant());
+    }
+
+    int expected = 0;
+
+    for (IntTopDownTree::iterator it = tree->begin(); it != tree->end(); ++it) {
+        AssertEquals(expected++, *it);
+    }
+
+    AssertEquals(amount, expected);
+    random_shuffle(numbers, numbers+amount);
+
+    for (int i = 0; i < amount; i++) {
+        AssertTrue(tree->remove(numbers[i]));
+        AssertFalse(tree->remove(numbers[i]));
+        AssertFalse(tree->contains(numbers[i]));
+        AssertTrue(tree->invariant());
+    }
+
+    AssertTrue(tree->empty());
+    delete tree;
+    TestPassed;
+}
+
+bool randomFiltered(int amount) {
+    //Grows past the initial filter capacity and shrinks back again
+    IntFilteredTree* tree = new IntFilteredTree();
+    int numbers[amount];
+
+    for (int i = 0; i < amount; i++) {
+        numbers[i] = i * 2;
+    }
+
+    random_shuffle(numbers, numbers+amount);
+
+    for (int i = 0; i < amount; i++) {
+        AssertTrue(tree->insert(numbers[i]));
+        AssertFalse(tree->insert(numbers[i]));
+    }
+
+    AssertTrue(tree->invariant());
+    AssertTrue((tree->filterCapacity() >= (size_t)amount));
+
+    //Odd keys were never inserted
+    for (int i = 0; i < amount; i++) {
+        AssertTrue(tree->contains(i * 2));
+        AssertFalse(tree->contains(i * 2 + 1));
+    }
+
+    random_shuffle(numbers, numbers+amount);
+
+    for (int i = 0; i < amount; i++) {
+        AssertTrue(tree->remove(numbers[i]));
+        AssertFalse(tree->remove(numbers[i]));
+        AssertFalse(tree->contains(numbers[i]));
+
+        if (i % 512 == 0) {
+            AssertTrue(tree->invariant());
+        }
+    }
+
+    AssertTrue(tree->empty());
+    AssertEquals(IntFilteredTree::MIN_CAPACITY, tree->filterCapacity());
+    delete tree;
+
+    //A moved-from tree is empty and can be filled again without a rebuild per insert
+    IntFilteredTree source;
+
+    for (int i = 0; i < amount; i++) {
+        source.insert(i);
+    }
+
+    IntFilteredTree moved(std::move(source));
+    AssertEquals((size_t)amount, moved.size());
+    AssertTrue(moved.contains(amount - 1));
+    AssertTrue(source.empty());
+    AssertEquals((size_t)0, source.size());
+    AssertEquals(IntFilteredTree::MIN_CAPACITY, source.filterCapacity());
+    AssertFalse(source.contains(1));
+
+    for (int i = 0; i < amount; i++) {
+        AssertTrue(source.insert(i));
+    }
+
+    AssertTrue((source.filterCapacity() >= (size_t)amount));
+    AssertTrue(source.invariant());
+
+    IntFilteredTree assigned;
+    assigned.insert(-1);
+    assigned = std::move(source);
+    AssertEquals((size_t)amount, assigned.size());
+    AssertFalse(assigned.contains(-1));
+    AssertTrue(source.empty());
+    AssertFalse(source.contains(-1));
+    AssertTrue((source.insert(3) && source.contains(3)));
+    AssertTrue((source.invariant() && assigned.invariant()));
+    TestPassed;
+}
+
+bool randomCached(int amount) {
+    //Few slots, so the slots are replaced and removed keys were cached before
+    IntCachedTree* tree = new IntCachedTree(16);
+    int numbers[amount];
+
+    for (int i = 0; i < amount; i++) {
+        numbers[i] = i;
+    }
+
+    random_shuffle(numbers, numbers+amount);
+
+    for (int i = 0; i < amount; i++) {
+        AssertTrue(tree->insert(numbers[i]));
+        AssertTrue(tree->contains(numbers[i / 2]));
+    }
+
+    AssertTrue(tree->invariant());
+    random_shuffle(numbers, numbers+amount);
+
+    //The last 8 keys stay in the tree
+    for (int i = 0; i < amount - 8; i++) {
+        int hot = numbers[amount - 1 - (i % 8)];
+
+        //Hot keys are looked up between removes that rotate the tree
+        AssertTrue(tree->contains(numbers[i]));
+        AssertEquals(hot, *tree->find(hot));
+        AssertTrue(tree->remove(numbers[i]));
+        AssertFalse(tree->contains(numbers[i]));
+        AssertTrue((tree->find(numbers[i]) == tree->end()));
+
+        if (i % 64 == 0) {
+            AssertTrue(tree->invariant());
+        }
+    }
+
+    AssertTrue(tree->invariant());
+    tree->clear();
+    AssertTrue(tree->invariant());
+    AssertFalse(tree->contains(numbers[amount - 1]));
+    delete tree;
+    TestPassed;
+}
+
+bool intervalQueries(IntIntervalTree& tree, vector<RBInterval<int>>& intervals) {
+    //Compare overlap queries against a linear scan
+    for (int q = 0; q < 200; q++) {
+        int from = rand() % 10000;
+        int to = from + rand() % 300;
+        vector<RBInterval<int>> expected;
+        vector<RBInterval<int>> found;
+
+        for (size_t i = 0; i < intervals.size(); i++) {
+            if (intervals[i].overlaps(from, to)) {
+                expected.push_back(intervals[i]);
+            }
+        }
+
+        sort(expected.begin(), expected.end(), RBIntervalLess<int>());
+        overlapping(tree, from, to, [&](const RBInterval<int>& interval) { found.push_back(interval); });
+        AssertEquals(expected.size(), found.size());
+        AssertTrue((expected == found));
+    }
+
+    TestPassed;
+}
+
+bool randomIntervals(int amount) {
+    IntIntervalTree tree;
+    vector<RBInterval<int>> intervals;
+
+    for (int i = 0; i < amount; i++) {
+        int start = rand() % 10000;
+        RBInterval<int> interval(start, start + rand() % 500);
+
+        if (tree.insert(interval)) {
+            intervals.push_back(interval);
+        }
+    }
+
+    AssertTrue(tree.invariant());
+    AssertTrue(intervalQueries(tree, intervals));
+
+    //Removing changes the maximum ends on the path
+    random_shuffle(intervals.begin(), intervals.end());
+
+    for (int i = 0; i < amount / 2; i++) {
+        AssertTrue(tree.remove(intervals.back()));
+        intervals.pop_back();
+    }
+
+    AssertTrue(tree.invariant());
+    AssertTrue(intervalQueries(tree, intervals));
+
+    //Bulk operations rebuild or join subtrees
+    tree.erase_range(RBInterval<int>(2000, 0), RBInterval<int>(3000, 0));
+    tree.erase_if([](const RBInterval<int>& interval) { return interval.end % 7 == 0; });
+    AssertTrue(tree.invariant());
+
+    intervals.erase(remove_if(intervals.begin(), intervals.end(), [](const RBInterval<int>& interval) {
+        return (interval.start >= 2000 && interval.start < 3000) || interval.end % 7 == 0;
+    }), intervals.end());
+
+    AssertTrue(intervalQueries(tree, intervals));
+
+    IntIntervalTree other;
+    other.assign_parallel(intervals.begin(), intervals.begin() + intervals.size() / 2, 4);
+    AssertTrue(other.invariant());
+
+    for (size_t i = 0; i < intervals.size(); i += 3) {
+        IntIntervalTree::node_type handle = tree.extract(intervals[i]);
+        AssertFalse(handle.empty());
+
+        //Intervals that are already in the other tree go back
+        if (!other.insert(std::move(handle))) {
+            AssertTrue(tree.insert(std::move(handle)));
+        }
+    }
+
+    AssertTrue(tree.invariant());
+    AssertTrue(other.invariant());
+    tree.merge(other);
+    AssertTrue(tree.invariant());
+    AssertTrue(intervalQueries(tree, intervals));
+
+    IntIntervalTree copy(tree);
+    copy.defragment();
+    AssertTrue(copy.invariant());
+    AssertTrue(intervalQueries(copy, intervals));
+    TestPassed;
+}
+
+bool randomMerkleDiff(int amount, int changes) {
+    //Same keys inserted in a different order, then a few changes on both sides
+    IntMerkleTree* first = new IntMerkleTree();
+    IntMerkleTree* second = new IntMerkleTree();
+    int numbers[amount];
+
+    for (int i = 0; i < amount; i++) {
+        numbers[i] = i * 2;
+        first->insert(numbers[i]);
+    }
+
+    random_shuffle(numbers, numbers+amount);
+
+    for (int i = 0; i < amount; i++) {
+        second->insert(numbers[i]);
+    }
+
+    AssertTrue((first->root_view().augment() == second->root_view().augment()));
+
+    for (int i = 0; i < changes; i++) {
+        int key = rand() % (amount * 2);
+
+        if (rand() % 2) {
+            first->remove(key);
+        } else if (key % 2 == 1) {
+            second->insert(key);
+        } else {
+            second->remove(key);
+        }
+    }
+
+    AssertTrue(first->invariant());
+    AssertTrue(second->invariant());
+
+    vector<int> onlyFirst;
+    vector<int> onlySecond;
+
+    for (int key = 0; key < amount * 2; key++) {
+        if (first->contains(key) != second->contains(key)) {
+            (first->contains(key) ? onlyFirst : onlySecond).push_back(key);
+        }
+    }
+
+    vector<int> foundFirst;
+    vector<int> foundSecond;
+
+    diff(*first, *second, [&](const int& key, bool inFirst) {
+        (inFirst ? foundFirst : foundSecond).push_back(key);
+    });
+
+    AssertTrue((foundFirst == onlyFirst));
+    AssertTrue((foundSecond == onlySecond));
+    AssertTrue((onlyFirst.size() + onlySecond.size() > 0));
+
+    //The summaries of both trees over the same bounds find the same ranges
+    RBMerkleSummary<int> summary = merkle_summary(*first, 4);
+    RBMerkleSummary<int> replica = merkle_summary(*second, summary.bounds);
+    vector<size_t> ranges = diff(summary, replica);
+
+    AssertEquals(16u, (unsigned int)summary.hashes.size());
+
+    for (size_t r = 0; r < summary.hashes.size(); r++) {
+        bool changed = false;
+
+        for (size_t i = 0; i < onlyFirst.size() + onlySecond.size(); i++) {
+            int key = (i < onlyFirst.size()) ? onlyFirst[i] : onlySecond[i - onlyFirst.size()];
+            changed |= (r == 0 || summary.bounds[r - 1] <= key) &&
+                       (r == summary.bounds.size() || key < summary.bounds[r]);
+        }
+
+        AssertEquals(changed, (find(ranges.begin(), ranges.end(), r) != ranges.end()));
+    }
+
+    delete first;
+    delete second;
+    TestPassed;
+}
+
+template<typename Tree>
+bool rangeInsert(int amount, int batch) {
+    //Batches with duplicates within the batch and with the tree, the
+    //reference tree gets the same keys one by one
+    Tree tree;
+    Tree reference;
+    int range = amount * 2 + batch;
+
+    for (int i = 0; i < amount; i++) {
+        int key = rand() % range;
+        tree.insert(key);
+        reference.insert(key);
+    }
+
+    vector<int> keys;
+
+    for (int i = 0; i < batch; i++) {
+        keys.push_back(rand() % range);
+        reference.insert(keys.back());
+    }
+
+    tree.insert(keys.begin(), keys.end());
+    AssertTrue(tree.invariant());
+
+    vector<int> contents(tree.begin(), tree.end());
+    vector<int> expected(reference.begin(), reference.end());
+    AssertTrue((contents == expected));
+    TestPassed;
+}
+
+bool randomBuffered(int amount, size_t capacity) {
+    IntBufferedTree tree(capacity);
+    vector<int> keys;
+
+    for (int i = 0; i < amount; i++) {
+        int key = rand() % amount;
+        tree.insert(key);
+        keys.push_back(key);
+
+        //Reads between the inserts see the buffered keys
+        if (i % 97 == 0) {
+            AssertTrue(tree.contains(keys[rand() % keys.size()]));
+            AssertTrue(tree.invariant());
+        }
+    }
+
+    for (size_t i = 0; i < keys.size(); i++) {
+        AssertTrue(tree.contains(keys[i]));
+    }
+
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+
+    //Iteration merges the buffer
+    vector<int> contents(tree.begin(), tree.end());
+    AssertEquals(0u, (unsigned int)tree.buffered());
+    AssertTrue((contents == keys));
+
+    for (size_t i = 0; i < keys.size(); i += 2) {
+        tree.insert(keys[i]);
+        AssertTrue(tree.remove(keys[i]));
+        AssertFalse(tree.contains(keys[i]));
+    }
+
+    AssertTrue(tree.invariant());
+    TestPassed;
+}
+
+bool randomLazy(int amount, double deadRatio, size_t budget) {
+    IntLazyTree tree(deadRatio);
+    vector<bool> present(amount, false);
+    size_t live = 0;
+
+    for (int i = 0; i < amount * 4; i++) {
+        int key = rand() % amount;
+
+        if (rand() % 2) {
+            AssertEquals(!present[key], tree.insert(key));
+            live += present[key] ? 0 : 1;
+            present[key] = true;
+        } else {
+            AssertEquals((bool)present[key], tree.remove(key));
+            live -= present[key] ? 1 : 0;
+            present[key] = false;
+        }
+
+        //Dead nodes are removed step by step between the operations
+        if (budget > 0 && i % 7 == 0) {
+            tree.compact_step(budget);
+        }
+
+        if (i % 97 == 0) {
+            AssertTrue(tree.invariant());
+        }
+
+        //The automatic compaction on the inserts keeps up with the removes,
+        //a pass adds at most one dead node per AUTO_STEP visited nodes
+        if (deadRatio < 1.0) {
+            size_t nodes = tree.size() + tree.dead();
+            AssertTrue((tree.dead() <= deadRatio * nodes + 2 * nodes / IntLazyTree::AUTO_STEP + 1));
+        }
+    }
+
+    AssertEquals(live, tree.size());
+    AssertTrue(tree.invariant());
+
+    vector<int> keys;
+
+    for (int key = 0; key < amount; key++) {
+        AssertEquals((bool)present[key], tree.contains(key));
+        AssertEquals((bool)present[key], (tree.find(key) != tree.end()));
+        if (present[key]) keys.push_back(key);
+    }
+
+    //Iteration skips the dead nodes
+    vector<int> contents(tree.begin(), tree.end());
+    AssertTrue((contents == keys));
+
+    tree.compact();
+    AssertEquals(0u, (unsigned int)tree.dead());
+    AssertEquals(live, tree.size());
+    AssertTrue(tree.invariant());
+
+    //A full incremental pass leaves no dead nodes behind
+    for (size_t i = 0; i < keys.size(); i += 2) {
+        AssertTrue(tree.remove(keys[i]));
+    }
+
+    while (!tree.compact_step(16)) {}
+    AssertEquals(0u, (unsigned int)tree.dead());
+    AssertTrue(tree.invariant());
+
+    //Removes without inserts only mark their nodes up to the middle between
+    //the ratio and all nodes, then they advance the compaction themselves
+    for (size_t i = 1; i < keys.size(); i += 2) {
+        size_t dead = tree.dead();
+        size_t nodes = tree.size() + dead;
+        double limit = (1 + deadRatio) / 2 * nodes;
+        AssertTrue(tree.remove(keys[i]));
+
+        if (dead + 1 <= limit) {
+            AssertEquals(dead + 1, tree.dead());
+        }
+
+        AssertTrue((tree.dead() <= limit + 2 * nodes / IntLazyTree::AUTO_STEP + 1));
+    }
+
+    AssertTrue(tree.empty());
+    AssertTrue(tree.invariant());
+    TestPassed;
+}
+
+template<typename Tree>
+bool randomMerge(int treeCount, int amount, bool unique) {
+    vector<Tree> trees(treeCount);
+    vector<Tree*> pointers;
+    vector<int> keys;
+
+    for (int i = 0; i < treeCount; i++) {
+        pointers.push_back(&trees[i]);
+    }
+
+    //Overlapping key ranges, so equal keys are spread over several trees
+    for (int i = 0; i < amount && treeCount > 0; i++) {
+        int key = rand() % amount;
+
+        if (trees[rand() % treeCount].insert(key)) {
+            keys.push_back(key);
+        }
+    }
+
+    sort(keys.begin(), keys.end());
+
+    if (unique) {
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    }
+
+    RBMergeIterator<Tree> it(pointers, unique);
+    vector<int> merged;
+
+    for (; it; ++it) {
+        merged.push_back(*it);
+        AssertTrue((trees[it.source()].count(*it) > 0));
+    }
+
+    AssertTrue((merged == keys));
+
+    for (int i = 0; i < 50; i++) {
+        int key = rand() % (amount + 2) - 1;
+        it.seek(key);
+
+        vector<int>::iterator expected = lower_bound(keys.begin(), keys.end(), key);
+
+        for (int j = 0; j < 20 && expected != keys.end(); j++, ++expected, ++it) {
+            AssertTrue((bool)it);
+            AssertEquals(*expected, *it);
+        }
+
+        if (expected == keys.end()) {
+            AssertFalse((bool)it);
+        }
+    }
+
+    it.rewind();
+    AssertEquals(!keys.empty(), (bool)it);
+    TestPassed;
+}
+
+template<typename Tree>
+bool randomJumpTable(int amount, unsigned int bits, long long offset) {
+    typedef typename Tree::value_type Key;
+    Tree tree;
+    vector<bool> present(amount, false);
+
+    tree.setJumpTable(bits);
+    AssertEquals(bits, tree.jumpTableBits());
+
+    for (int i = 0; i < amount * 8; i++) {
+        int index = rand() % amount;
+        Key key = (Key)(offset + index);
+        int operation = rand() % 100;
+
+        if (operation < 45) {
+            AssertEquals(!present[index], tree.insert(key));
+            present[index] = true;
+        } else if (operation < 80) {
+            AssertEquals((bool)present[index], tree.remove(key));
+            present[index] = false;
+        } else if (operation < 98) {
+            AssertEquals((bool)present[index], tree.contains(key));
+        } else if (operation == 98) {
+            //Node handles leave and enter the tree without a lookup of the table
+            typename Tree::node_type handle = tree.extract(key);
+            AssertEquals((bool)present[index], (bool)handle);
+            if (handle) AssertTrue(tree.insert(std::move(handle)));
+        } else {
+            tree.defragment_step(64);
+        }
+
+        if (i % 101 == 0) {
+            AssertTrue(tree.invariant());
+        }
+
+        //Bulk changes rebuild the table
+        if (i == amount * 4) {
+            int from = rand() % amount;
+            int to = min(amount, from + amount / 10);
+            tree.erase_range((Key)(offset + from), (Key)(offset + to));
+            fill(present.begin() + from, present.begin() + to, false);
+            AssertTrue(tree.invariant());
+        }
+    }
+
+    vector<Key> keys;
+
+    for (int index = 0; index < amount; index++) {
+        if (present[index]) keys.push_back((Key)(offset + index));
+    }
+
+    vector<Key> contents(tree.begin(), tree.end());
+    AssertTrue((contents == keys));
+
+    //Keys beyond the range of the table are found and move the range
+    for (int index = amount; index < amount * 3; index++) {
+        AssertTrue(tree.insert((Key)(offset + index)));
+        AssertTrue(tree.contains((Key)(offset + index)));
+    }
+
+    AssertTrue(tree.invariant());
+
+    //The copy has a table of its own
+    Tree copy(tree);
+    AssertEquals(bits, copy.jumpTableBits());
+    AssertTrue(copy.contains((Key)(offset + amount)));
+    AssertTrue(copy.invariant());
+
+    tree.setJumpTable(0);
+    AssertEquals(0u, tree.jumpTableBits());
+    AssertTrue(tree.contains((Key)(offset + amount * 2)));
+    TestPassed;
+}
+
+//Value that counts how often it was copied
+struct CopiedValue {
+    static int copies;
+
+    CopiedValue() {}
+    CopiedValue(const CopiedValue&) { copies++; }
+    CopiedValue& operator= (const CopiedValue&) { copies++; return *this; }
+};
+
+int CopiedValue::copies = 0;
+
+bool randomSlabMap(int amount) {
+    //Strings own memory, so missing destructors or copies show up in the checks
+    RBSlabMap<int, string> map;
+    vector<bool> present(amount, false);
+    vector<string> values(amount);
+
+    for (int i = 0; i < amount * 4; i++) {
+        int key = rand() % amount;
+        string value = to_string(rand()) + string(rand() % 40, 'x');
+        int operation = rand() % 4;
+
+        if (operation == 0) {
+            AssertEquals(!present[key], map.insert(key, value));
+            if (!present[key]) values[key] = value;
+            present[key] = true;
+        } else if (operation == 1) {
+            map.assign(key, value);
+            values[key] = value;
+            present[key] = true;
+        } else if (operation == 2) {
+            AssertEquals((bool)present[key], map.remove(key));
+            present[key] = false;
+        } else {
+            string* stored = map.find(key);
+            AssertEquals((bool)present[key], (stored != NULL));
+            if (stored != NULL) AssertTrue((*stored == values[key]));
+        }
+
+        if (i % 97 == 0) {
+            AssertTrue(map.invariant());
+        }
+    }
+
+    RBSlabMap<int, string> copy(map);
+    RBSlabMap<int, string> assigned;
+    assigned.insert(-1, "replaced");
+    assigned = map;
+
+    //The copies own their values
+    map.clear();
+    AssertTrue(map.empty());
+
+    size_t live = 0;
+
+    for (int key = 0; key < amount; key++) {
+        live += present[key];
+    }
+
+    AssertEquals(live, copy.size());
+    AssertTrue(copy.invariant() && assigned.invariant());
+
+    int previous = -1;
+
+    for (RBSlabMap<int, string>::iterator it = copy.begin(); it != copy.end(); ++it) {
+        AssertTrue((it.key() > previous && present[it.key()]));
+        AssertTrue((it.value() == values[it.key()]));
+        AssertTrue((*assigned.find(it.key()) == it.value()));
+        previous = it.key();
+    }
+
+    AssertFalse(assigned.contains(-1));
+
+    //A duplicate insert does not copy its value into the slab
+    RBSlabMap<int, CopiedValue> copies;
+    CopiedValue value;
+    AssertTrue(copies.insert(1, value));
+    AssertEquals(1, CopiedValue::copies);
+    AssertFalse(copies.insert(1, value));
+    AssertEquals(1, CopiedValue::copies);
+    TestPassed;
+}
+
+bool randomCombining(unsigned int threads, size_t slots, int amount) {
+    //More threads than slots share slots, every thread counts its successful
+    //inserts and removes per key to check the final contents
+    RBCombiningTree<int> tree(slots);
+    vector<vector<int>> balance(threads, vector<int>(amount, 0));
+    vector<thread> workers;
+    atomic<int> failures(0);
+
+    for (unsigned int t = 0; t < threads; t++) {
+        workers.push_back(thread([&, t]() {
+            unsigned int state = t * 7919 + 1;
+
+            for (int i = 0; i < amount * 4; i++) {
+                state = state * 1103515245 + 12345;
+                int key = (state >> 8) % amount;
+                int operation = (state >> 4) % 3;
+
+                if (operation == 0) {
+                    balance[t][key] += tree.insert(key);
+                } else if (operation == 1) {
+                    balance[t][key] -= tree.remove(key);
+                } else {
+                    tree.contains(key);
+                }
+            }
+
+            //Keys of this thread alone have a known result
+            int own = -1 - (int)t;
+
+            if (!tree.insert(own) || !tree.contains(own) || !tree.remove(own) || tree.contains(own)) {
+                failures++;
+            }
+        }));
+    }
+
+    for (unsigned int t = 0; t < threads; t++) {
+        workers[t].join();
+    }
+
+    AssertEquals(0, failures.load());
+    AssertTrue(tree.invariant());
+
+    vector<int> expected;
+
+    for (int key = 0; key < amount; key++) {
+        int net = 0;
+
+        for (unsigned int t = 0; t < threads; t++) {
+            net += balance[t][key];
+        }
+
+        AssertTrue((net == 0 || net == 1));
+        if (net == 1) expected.push_back(key);
+    }
+
+    vector<int> contents;
+    tree.exclusive([&](RBTree<int>& inner) {
+        contents.assign(inner.begin(), inner.end());
+    });
+
+    AssertTrue((contents == expected));
+    TestPassed;
+}
+
+//Comparator that fails for one key to check that the error reaches its thread
+struct FailingLess {
+    bool operator() (int a, int b) const {
+        if (a == 13 || b == 13) throw runtime_error("failing key");
+        return a < b;
+    }
+};
+
+bool combiningError() {
+    RBCombiningTree<int, FailingLess> tree(4);
+    AssertTrue(tree.insert(1));
+    AssertTrue(tree.insert(20));
+
+    bool thrown = false;
+
+    try {
+        tree.insert(13);
+    } catch (const runtime_error&) {
+        thrown = true;
+    }
+
+    AssertTrue(thrown);
+    AssertTrue(tree.contains(20));
+    AssertFalse(tree.contains(2));
+    AssertTrue(tree.invariant());
+    TestPassed;
+}
+
+bool randomStringKeys(int amount) {
+    //Keys around the inline and the prefix size share long prefixes
+    vector<string> texts;
+
+    for (int i = 0; i < amount; i++) {
+        string text = (rand() % 2) ? "https://example.org/" : "https://exa";
+        int extra = rand() % 24;
+
+        for (int j = 0; j < extra; j++) {
+            text += (char)('a' + rand() % 3);
+        }
+
+        texts.push_back(text);
+    }
+
+    for (int i = 0; i < amount; i++) {
+        RBStringKey a(texts[i]);
+        RBStringKey b(texts[(i * 7) % amount]);
+        int expected = texts[i].compare(texts[(i * 7) % amount]);
+
+        AssertEquals(texts[i], a.str());
+        AssertEquals((expected < 0), (a < b));
+        AssertEquals((expected == 0), (a == b));
+        AssertEquals((expected < 0), RBStringKeyLess()(a, texts[(i * 7) % amount]));
+        AssertEquals((expected > 0), RBStringKeyLess()(texts[(i * 7) % amount], a));
+    }
+
+    RBStringTree<> tree;
+
+    for (int i = 0; i < amount; i++) {
+        tree.insert(RBStringKey(texts[i]));
+    }
+
+    AssertTrue(tree.invariant());
+
+    for (int i = 0; i < amount; i++) {
+        AssertTrue(tree.contains(texts[i]));
+        AssertFalse(tree.contains(texts[i] + "z"));
+    }
+
+    TestPassed;
+}
+
+//Key that counts its live copies to check which thread frees the nodes
+struct TrackedKey {
+    static atomic<int> live;
+    int value;
+
+    TrackedKey(int value) : value(value) { live++; }
+    TrackedKey(const TrackedKey& other) : value(other.value) { live++; }
+    ~TrackedKey() { live--; }
+
+    bool operator< (const TrackedKey& other) const { return value < other.value; }
+};
+
+atomic<int> TrackedKey::live(0);
+
+bool nodeCacheChurn(unsigned int threads, int trees, int keys) {
+    //Trees built by one thread are destroyed by the next one, so the nodes
+    //are freed on other threads than they were allocated on
+    typedef RBTree<long> LongTree;
+    LongTree::setNodeCache(16);
+    AssertEquals((size_t)16, LongTree::nodeCacheBatches());
+
+    vector<vector<LongTree*>> built(threads);
+    atomic<int> failures(0);
+
+    for (unsigned int round = 0; round < 4; round++) {
+        vector<thread> workers;
+
+        for (unsigned int t = 0; t < threads; t++) {
+            workers.push_back(thread([&, t]() {
+                vector<LongTree*>& owned = built[(t + round) % threads];
+                unsigned int state = (t + 1) * (round + 7);
+
+                for (size_t i = 0; i < owned.size(); i++) {
+                    delete owned[i];
+                }
+
+                owned.clear();
+
+                for (int i = 0; i < trees; i++) {
+                    LongTree* tree = new LongTree();
+
+                    for (int k = 0; k < keys; k++) {
+                        state = state * 1103515245 + 12345;
+                        tree->insert((state >> 8) % (keys * 2));
+                    }
+
+                    if (!tree->invariant()) failures++;
+                    owned.push_back(tree);
+                }
+            }));
+        }
+
+        for (unsigned int t = 0; t < threads; t++) {
+            workers[t].join();
+        }
+    }
+
+    AssertEquals(0, failures.load());
+
+    for (unsigned int t = 0; t < threads; t++) {
+        for (size_t i = 0; i < built[t].size(); i++) {
+            AssertTrue((is_sorted(built[t][i]->begin(), built[t][i]->end())));
+            delete built[t][i];
+        }
+    }
+
+    //Freed nodes are handed out again
+    LongTree first;
+    vector<const long*> addresses;
+
+    for (int k = 0; k < keys; k++) {
+        first.insert(k);
+    }
+
+    for (LongTree::iterator it = first.begin(); it != first.end(); ++it) {
+        addresses.push_back(&*it);
+    }
+
+    first.clear();
+    sort(addresses.begin(), addresses.end());
+
+    LongTree second;
+    int reused = 0;
+
+    for (int k = 0; k < keys; k++) {
+        second.insert(k);
+    }
+
+    for (LongTree::iterator it = second.begin(); it != second.end(); ++it) {
+        reused += binary_search(addresses.begin(), addresses.end(), &*it);
+    }
+
+    AssertEquals(keys, reused);
+    AssertTrue(second.invariant());
+
+    //A thread that only allocates returns the rest of its batch when it ends,
+    //leaks show up in sanitizer builds
+    second.clear();
+    LongTree* handed = NULL;
+    thread builder([&]() {
+        handed = new LongTree();
+
+        for (long k = 0; k < 5; k++) {
+            handed->insert(k);
+        }
+    });
+
+    builder.join();
+    AssertEquals((size_t)5, (size_t)distance(handed->begin(), handed->end()));
+    delete handed;
+
+    LongTree::setNodeCache(0);
+    AssertEquals((size_t)0, LongTree::nodeCacheBatches());
+    TestPassed;
+}
+
+//Compares C strings in constant expressions
+struct KeywordLess {
+    constexpr bool operator() (const char* a, const char* b) const {
+        while (*a != '\0' && *a == *b) {
+            a++;
+            b++;
+        }
+
+        return (unsigned char)*a < (unsigned char)*b;
+    }
+};
+
+constexpr RBStaticTree<int, 16> staticOpcodes = {0x10, 0x01, 0x7f, 0x22, 0x05, 0x40, 0x33, 0x01, 0x60, 0x02};
+
+constexpr RBStaticTree<const char*, 8, KeywordLess> staticKeywords =
+    {"while", "if", "else", "return", "for", "do", "break", "continue"};
+
+//Ascending keys produce the most rotations
+constexpr RBStaticTree<int, 200> staticSquares() {
+    RBStaticTree<int, 200> tree;
+
+    for (int i = 0; i < 200; i++) {
+        tree.insert(i * i);
+    }
+
+    return tree;
+}
+
+//These are evaluated by the compiler
+static_assert(staticOpcodes.size() == 9, "duplicates are dropped");
+static_assert(staticOpcodes.contains(0x33) && !staticOpcodes.contains(0x34), "opcode lookup");
+static_assert(staticOpcodes.invariant(), "opcode tree is balanced");
+static_assert(staticKeywords.contains("return") && !staticKeywords.contains("goto"), "keyword lookup");
+static_assert(staticKeywords.invariant(), "keyword tree is balanced");
+static_assert(staticSquares().invariant() && staticSquares().contains(199 * 199), "squares tree");
+static_assert(make_static_tree<int>(3, 1, 2).capacity() == 3, "exact capacity");
+
+bool staticTree() {
+    //Runtime lookups use the trees built by the compiler
+    constexpr RBStaticTree<int, 200> squares = staticSquares();
+    int previous = -1;
+    int visited = 0;
+
+    for (int key : squares) {
+        AssertTrue((key > previous));
+        previous = key;
+        visited++;
+    }
+
+    AssertEquals(200, visited);
+
+    for (int i = 0; i < 40000; i++) {
+        int root = 0;
+        while ((root + 1) * (root + 1) <= i) root++;
+
+        AssertEquals((root * root == i), squares.contains(i));
+    }
+
+    const int* found = staticOpcodes.find(0x7f);
+    AssertTrue((found != NULL && *found == 0x7f));
+    AssertTrue((staticOpcodes.find(0x7e) == NULL));
+    AssertTrue((string(*staticKeywords.begin()) == "break"));
+
+    //A tree may also be filled at runtime up to its capacity
+    RBStaticTree<int, 4> small;
+    AssertTrue((small.insert(4) && small.insert(2) && small.insert(8) && small.insert(6)));
+    AssertFalse(small.insert(2));
+
+    bool thrown = false;
+
+    try {
+        small.insert(10);
+    } catch (const length_error&) {
+        thrown = true;
+    }
+
+    AssertTrue(thrown);
+    AssertTrue(small.invariant());
+    TestPassed;
+}
+
 int main() {
     Test testSuite[] = {
         {"Inserting 1 element into empty tree", []() {
@@ -190,639 +1523,1569 @@ int main() {
             tree->insert(5);
 
             AssertTrue(tree->invariant());
-            AssertEquals(true, tree->contains(5));
-            AssertEquals("└── 5 (B)\n", tree->toString());
+            AssertEquals(true, tree->contains(5));
+            AssertEquals("└── 5 (B)\n", tree->toString());
+
+            delete tree;
+            TestPassed;
+        }},
+        {"Inserting 2 elements", []() { 
+            IntTree* tree = new IntTree();
+            tree->insert(5);
+            AssertTrue(tree->invariant());
+
+            tree->insert(7);
+            AssertTrue(tree->invariant());
+
+            AssertTrue(tree->contains(5));
+            AssertTrue(tree->contains(7));
+            AssertEquals("└── 5 (B)\n    └── 7 (R)\n", tree->toString());
+
+            delete tree;
+            TestPassed;
+        }},
+        {"Inserting 3 elements", []() {
+            IntTree* tree = new IntTree();
+            tree->insert(5);
+            AssertTrue(tree->invariant());
+
+            tree->insert(7);
+            AssertTrue(tree->invariant());
+
+            tree->insert(3);
+            AssertTrue(tree->invariant());
+
+            AssertTrue(tree->contains(5));
+            AssertTrue(tree->contains(7));
+            AssertTrue(tree->contains(3));
+            AssertEquals("└── 5 (B)\n    ├── 3 (R)\n    └── 7 (R)\n", tree->toString());
+
+            delete tree;
+            TestPassed;
+        }},
+        {"Inserting adjust case 1", []() {
+            //case: current node is the root
+            IntTree* tree = new IntTree();
+            tree->insert(1);
+            AssertTrue(tree->invariant());
+
+            tree->insert(3);
+            AssertTrue(tree->invariant());
+
+            tree->insert(4);
+            AssertTrue(tree->invariant());
+
+            tree->insert(2);
+            AssertTrue(tree->invariant());
+
+            AssertTrue(tree->contains(1));
+            AssertTrue(tree->contains(3));
+            AssertTrue(tree->contains(4));
+            AssertTrue(tree->contains(2));
+            AssertEquals("└── 3 (B)\n    ├── 1 (B)\n    │   └── 2 (R)\n    └── 4 (B)\n", tree->toString());
+
+            delete tree;
+            TestPassed;
+        }},
+        {"Inserting adjust case 2", []() {
+            //case: the parent is black
+            IntTree* tree = new IntTree();
+            tree->insert(2);
+            AssertTrue(tree->invariant());
+
+            tree->insert(4);
+            AssertTrue(tree->invariant());
+
+            tree->insert(1);
+            AssertTrue(tree->invariant());
+
+            AssertTrue(tree->contains(2));
+            AssertTrue(tree->contains(4));
+            AssertTrue(tree->contains(1));
+            AssertEquals("└── 2 (B)\n    ├── 1 (R)\n    └── 4 (R)\n", tree->toString());
+
+            delete tree;
+            TestPassed;
+        }},
+        {"Inserting adjust case 3", []() {
+            //case: parent and uncle are both red
+            IntTree* tree = new IntTree();
+            tree->insert(5);
+            AssertTrue(tree->invariant());
+
+            tree->insert(2);
+            AssertTrue(tree->invariant());
+
+            tree->insert(7);
+            AssertTrue(tree->invariant());
+
+            tree->insert(1);
+            AssertTrue(tree->invariant());
+
+            AssertTrue(tree->contains(5));
+            AssertTrue(tree->contains(2));
+            AssertTrue(tree->contains(7));
+            AssertTrue(tree->contains(1));
+            AssertEquals("└── 5 (B)\n    ├── 2 (B)\n    │   └── 1 (R)\n    └── 7 (B)\n", tree->toString());
+
+            delete tree;
+            TestPassed;
+        }},
+        {"Inserting adjust case 4 [right child, no uncle]", []() {
+            //case: parent red and no uncle (black) with node as right child
+            IntTree* tree = new IntTree();
+            tree->insert(3);
+            AssertTrue(tree->invariant());
+
+            tree->insert(1);
+            AssertTrue(tree->invariant());
+
+            tree->insert(7);
+            AssertTrue(tree->invariant());
+
+            tree->insert(9);
+            AssertTrue(tree->invariant());
+
+            tree->insert(8);
+            AssertTrue(tree->invariant());
+
+            AssertTrue(tree->contains(3));
+            AssertTrue(tree->contains(1));
+            AssertTrue(tree->contains(7));
+            AssertTrue(tree->contains(9));
+            AssertTrue(tree->contains(8));
+            AssertEquals("└── 3 (B)\n    ├── 1 (B)\n    └── 8 (B)\n        ├── 7 (R)\n        └── 9 (R)\n", tree->toString());
+
+            delete tree;
+            TestPassed;
+        }},
+        {"Inserting adjust case 4 [right child, with uncle]", []() {
+            //case: parent red and uncle (black) with node as right child
+            IntTree* tree = new IntTree();
+            tree->insert(5);
+            AssertTrue(tree->invariant());
+
+            tree->insert(10);
+            AssertTrue(tree->invariant());
+
+            tree->insert(6);
+            AssertTrue(tree->invariant());
+
+            tree->insert(17);
+            AssertTrue(tree->invariant());
+
+            tree->insert(18);
+            AssertTrue(tree->invariant());
+
+            tree->insert(7);
+            AssertTrue(tree->invariant());
+
+            tree->insert(8);
+            AssertTrue(tree->invariant());
+
+            //only here uncle is not null
+            tree->insert(14);
+            AssertTrue(tree->invariant());
+
+            AssertTrue(tree->contains(5));
+            AssertTrue(tree->contains(10));
+            AssertTrue(tree->contains(6));
+            AssertTrue(tree->contains(17));
+            AssertTrue(tree->contains(18));
+            AssertTrue(tree->contains(7));
+            AssertTrue(tree->contains(8));
+            AssertTrue(tree->contains(14));
+            AssertEquals("└── 8 (B)\n    ├── 6 (R)\n    │   ├── 5 (B)\n    │   └── 7 (B)\n    └── 17 (R)\n        ├── 10 (B)\n        │   └── 14 (R)\n        └── 18 (B)\n", tree->toString());
+
+            delete tree;
+            TestPassed;
+        }},
+        {"Inserting adjust case 5 [left child, no uncle]", []() {
+            //case: parent red and no uncle (black) with node as left child
+            IntTree* tree = new IntTree();
+            tree->insert(5);
+            AssertTrue(tree->invariant());
+
+            tree->insert(3);
+            AssertTrue(tree->invariant());
+
+            tree->insert(7);
+            AssertTrue(tree->invariant());
+
+            tree->insert(1);
+            AssertTrue(tree->invariant());
+
+            tree->insert(2);
+            AssertTrue(tree->invariant());
+
+            AssertTrue(tree->contains(5));
+            AssertTrue(tree->contains(3));
+            AssertTrue(tree->contains(7));
+            AssertTrue(tree->contains(1));
+            AssertTrue(tree->contains(2));
+            AssertEquals("└── 5 (B)\n    ├── 2 (B)\n    │   ├── 1 (R)\n    │   └── 3 (R)\n    └── 7 (B)\n", tree->toString());
+
+            delete tree;
+            TestPassed;
+        }},
+        {"Inserting adjust case 5 [left child, with uncle]", []() {
+            //case: parent red and uncle (black) with node as left child
+            IntTree* tree = new IntTree();
+            tree->insert(16);
+            AssertTrue(tree->invariant());
+
+            tree->insert(18);
+            AssertTrue(tree->invariant());
+
+            tree->insert(19);
+            AssertTrue(tree->invariant());
+
+            tree->insert(2);
+            AssertTrue(tree->invariant());
+
+            tree->insert(3);
+            AssertTrue(tree->invariant());
+
+            tree->insert(8);
+            AssertTrue(tree->invariant());
+
+            tree->insert(11);
+            AssertTrue(tree->invariant());
+
+            //only here uncle is not null
+            tree->insert(15);
+            AssertTrue(tree->invariant());
+
+            AssertTrue(tree->contains(16));
+            AssertTrue(tree->contains(18));
+            AssertTrue(tree->contains(19));
+            AssertTrue(tree->contains(2));
+            AssertTrue(tree->contains(3));
+            AssertTrue(tree->contains(8));
+            AssertTrue(tree->contains(11));
+            AssertTrue(tree->contains(15));
+            AssertEquals("└── 11 (B)\n    ├── 3 (R)\n    │   ├── 2 (B)\n    │   └── 8 (B)\n    └── 18 (R)\n        ├── 16 (B)\n        │   └── 15 (R)\n        └── 19 (B)\n", tree->toString());
+
+            delete tree;
+            TestPassed;
+        }},
+        {"Inserting 20 elements (sorted)", []() {
+            return sortedInsert(20);
+        }},
+        {"Inserting 20 elements (random)", []() {
+            return randomInsert(20);
+        }},
+        {"Inserting 50 elements (sorted)", []() {
+            return sortedInsert(50);
+        }},
+        {"Inserting 50 elements (random)", []() {
+            return randomInsert(50);
+        }},
+        {"Inserting 100 elements (random)", []() {
+            return randomInsert(100);
+        }},
+        {"Inserting 1000 elements (random)", []() {
+            return randomInsert(1000);
+        }},
+        {"Inserting 1 Mio elements (random)", []() {
+            return randomInsert(1000000, false, false);
+        }},
+        {"Removing the root node", []() {
+            IntTree* tree = new IntTree();
+            tree->insert(5);
+            tree->remove(5);
+            AssertTrue(tree->invariant());
+
+            AssertFalse(tree->contains(5));
+            AssertEquals("empty tree", tree->toString());
+
+            delete tree;
+            TestPassed;
+        }},
+        {"Removing a red leaf [0 childs]", []() {
+            IntTree* tree = new IntTree();
+            tree->insert(5);
+            tree->insert(1);
+            tree->insert(7);
+
+            tree->remove(7);
+            AssertTrue(tree->invariant());
+
+            AssertFalse(tree->contains(7));
+            AssertTrue(tree->contains(5));
+            AssertTrue(tree->contains(1));
+            AssertEquals("└── 5 (B)\n    └── 1 (R)\n", tree->toString());
+
+            delete tree;
+            TestPassed;
+        }},
+        {"Removing a black node with red child [1 child]", []() {
+            IntTree* tree = new IntTree();
+            tree->insert(5);
+            tree->insert(1);
+            tree->insert(7);
+            tree->insert(3);
+
+            tree->remove(1);
+            AssertTrue(tree->invariant());
+
+            AssertFalse(tree->contains(1));
+            AssertTrue(tree->contains(5));
+            AssertTrue(tree->contains(7));
+            AssertTrue(tree->contains(3));
+            AssertEquals("└── 5 (B)\n    ├── 3 (B)\n    └── 7 (B)\n", tree->toString());
+
+            delete tree;
+            TestPassed;
+        }},
+        {"Removing black leaf [0 childs]", []() {
+            IntTree* tree = new IntTree();
+            tree->insert(1);
+            tree->insert(2);
+            tree->insert(3);
+            tree->insert(4);
+
+            //remove 3 to get a completly black tree
+            tree->remove(3);
+            AssertTrue(tree->invariant());
+
+            tree->remove(4);
+            AssertTrue(tree->invariant());
+
+            AssertFalse(tree->contains(3));
+            AssertFalse(tree->contains(4));
+            AssertTrue(tree->contains(1));
+            AssertTrue(tree->contains(2));
+            AssertEquals("└── 2 (B)\n    └── 1 (R)\n", tree->toString());
+
+            delete tree;
+            TestPassed;
+        }},
+        {"Removing node with 1 child [red child]", []() {
+            IntTree* tree = new IntTree();
+            tree->insert(1);
+            tree->insert(2);
+            tree->insert(3);
+            tree->insert(4);
+
+            tree->remove(3);
+            AssertTrue(tree->invariant());
+
+            AssertFalse(tree->contains(3));
+            AssertTrue(tree->contains(1));
+            AssertTrue(tree->contains(2));
+            AssertTrue(tree->contains(4));
+            AssertEquals("└── 2 (B)\n    ├── 1 (B)\n    └── 4 (B)\n", tree->toString());
+
+            delete tree;
+            TestPassed;
+        }},
+        {"Removing node with 2 childs [root node]", []() {
+            IntTree* tree = new IntTree();
+            tree->insert(1);
+            tree->insert(2);
+            tree->insert(3);
+            tree->insert(4);
+
+            //remove 4 to get black childs for the root
+            tree->remove(4);
+            AssertTrue(tree->invariant());
+
+            tree->remove(2);
+            AssertTrue(tree->invariant());
+
+            AssertFalse(tree->contains(4));
+            AssertFalse(tree->contains(2));
+            AssertTrue(tree->contains(1));
+            AssertTrue(tree->contains(3));
+            AssertEquals("└── 3 (B)\n    └── 1 (R)\n", tree->toString());
 
             delete tree;
             TestPassed;
         }},
-        {"Inserting 2 elements", []() { 
+        {"Removing adjust case 1 [0 childs, root node]", []() {
             IntTree* tree = new IntTree();
-            tree->insert(5);
-            AssertTrue(tree->invariant());
-
             tree->insert(7);
+            tree->remove(7);
             AssertTrue(tree->invariant());
 
-            AssertTrue(tree->contains(5));
-            AssertTrue(tree->contains(7));
-            AssertEquals("└── 5 (B)\n    └── 7 (R)\n", tree->toString());
+            AssertFalse(tree->contains(7));
+            AssertEquals("empty tree", tree->toString());
 
             delete tree;
             TestPassed;
         }},
-        {"Inserting 3 elements", []() {
+        {"Removing adjust case 2 [0 childs, left node]", []() {
             IntTree* tree = new IntTree();
+            tree->insert(3);
+            tree->insert(2);
             tree->insert(5);
-            AssertTrue(tree->invariant());
-
             tree->insert(7);
-            AssertTrue(tree->invariant());
+            tree->insert(8);
+            tree->insert(9);
 
-            tree->insert(3);
+            tree->remove(2);
             AssertTrue(tree->invariant());
 
+            AssertFalse(tree->contains(2));
+            AssertTrue(tree->contains(3));
             AssertTrue(tree->contains(5));
             AssertTrue(tree->contains(7));
-            AssertTrue(tree->contains(3));
-            AssertEquals("└── 5 (B)\n    ├── 3 (R)\n    └── 7 (R)\n", tree->toString());
+            AssertTrue(tree->contains(8));
+            AssertTrue(tree->contains(9));
+            AssertEquals("└── 7 (B)\n    ├── 3 (B)\n    │   └── 5 (R)\n    └── 8 (B)\n        └── 9 (R)\n", tree->toString());
 
             delete tree;
             TestPassed;
         }},
-        {"Inserting adjust case 1", []() {
-            //case: current node is the root
+        {"Removing adjust case 2 [0 childs, right node]", []() {
             IntTree* tree = new IntTree();
+            tree->insert(8);
+            tree->insert(6);
+            tree->insert(7);
             tree->insert(1);
+            tree->insert(4);
+            tree->insert(3);
+
+            //same case when deleting the 7 (is root with 2 childs)
+            tree->remove(8);
             AssertTrue(tree->invariant());
 
+            AssertFalse(tree->contains(8));
+            AssertTrue(tree->contains(6));
+            AssertTrue(tree->contains(7));
+            AssertTrue(tree->contains(1));
+            AssertTrue(tree->contains(4));
+            AssertTrue(tree->contains(3));
+            AssertEquals("└── 4 (B)\n    ├── 1 (B)\n    │   └── 3 (R)\n    └── 7 (B)\n        └── 6 (R)\n", tree->toString());
+
+            delete tree;
+            TestPassed;
+        }},
+        {"Removing adjust case 3 [0 childs, symmetric]", []() {
+            IntTree* tree = new IntTree();
+            tree->insert(2);
+            tree->insert(19);
             tree->insert(3);
-            AssertTrue(tree->invariant());
+            tree->insert(6);
+            tree->insert(7);
+            tree->insert(10);
+            tree->insert(11);
+            tree->insert(18);
+            tree->insert(17);
+            tree->insert(20);
 
-            tree->insert(4);
+            //same case when deleting the 3 (with 2 childs)
+            tree->remove(6);
             AssertTrue(tree->invariant());
 
+            AssertFalse(tree->contains(6));
+            AssertTrue(tree->contains(2));
+            AssertTrue(tree->contains(19));
+            AssertTrue(tree->contains(3));
+            AssertTrue(tree->contains(7));
+            AssertTrue(tree->contains(10));
+            AssertTrue(tree->contains(11));
+            AssertTrue(tree->contains(18));
+            AssertTrue(tree->contains(17));
+            AssertTrue(tree->contains(20));
+
+            delete tree;
+            TestPassed;
+        }},
+        {"Removing adjust case 4 [0 childs, symmetric]", []() {
+            IntTree* tree = new IntTree();
+            tree->insert(7);
+            tree->insert(8);
+            tree->insert(3);
+            tree->insert(4);
+            tree->insert(5);
             tree->insert(2);
+
+            tree->remove(8);
             AssertTrue(tree->invariant());
 
-            AssertTrue(tree->contains(1));
+            AssertFalse(tree->contains(8));
+            AssertTrue(tree->contains(7));
             AssertTrue(tree->contains(3));
             AssertTrue(tree->contains(4));
+            AssertTrue(tree->contains(5));
             AssertTrue(tree->contains(2));
-            AssertEquals("└── 3 (B)\n    ├── 1 (B)\n    │   └── 2 (R)\n    └── 4 (B)\n", tree->toString());
+            AssertEquals("└── 4 (B)\n    ├── 3 (B)\n    │   └── 2 (R)\n    └── 7 (B)\n        └── 5 (R)\n", tree->toString());
 
             delete tree;
             TestPassed;
         }},
-        {"Inserting adjust case 2", []() {
-            //case: the parent is black
+        {"Removing adjust case 5 [0 childs, right sibling child red]", []() {
             IntTree* tree = new IntTree();
+            tree->insert(5);
+            tree->insert(1);
+            tree->insert(7);
             tree->insert(2);
-            AssertTrue(tree->invariant());
-
-            tree->insert(4);
-            AssertTrue(tree->invariant());
 
-            tree->insert(1);
+            tree->remove(7);
             AssertTrue(tree->invariant());
 
-            AssertTrue(tree->contains(2));
-            AssertTrue(tree->contains(4));
+            AssertFalse(tree->contains(7));
+            AssertTrue(tree->contains(5));
             AssertTrue(tree->contains(1));
-            AssertEquals("└── 2 (B)\n    ├── 1 (R)\n    └── 4 (R)\n", tree->toString());
+            AssertTrue(tree->contains(2));
+            AssertEquals("└── 2 (B)\n    ├── 1 (B)\n    └── 5 (B)\n", tree->toString());
 
             delete tree;
             TestPassed;
         }},
-        {"Inserting adjust case 3", []() {
-            //case: parent and uncle are both red
+        {"Removing adjust case 5 [0 childs, left sibling child red]", []() {
             IntTree* tree = new IntTree();
             tree->insert(5);
-            AssertTrue(tree->invariant());
+            tree->insert(1);
+            tree->insert(10);
+            tree->insert(7);
+            tree->insert(12);
+            tree->insert(11);
 
-            tree->insert(2);
+            tree->remove(7);
             AssertTrue(tree->invariant());
 
-            tree->insert(7);
-            AssertTrue(tree->invariant());
+            AssertFalse(tree->contains(7));
+            AssertTrue(tree->contains(5));
+            AssertTrue(tree->contains(1));
+            AssertTrue(tree->contains(10));
+            AssertTrue(tree->contains(12));
+            AssertTrue(tree->contains(11));
+            AssertEquals("└── 5 (B)\n    ├── 1 (B)\n    └── 11 (R)\n        ├── 10 (B)\n        └── 12 (B)\n", tree->toString());
 
+            delete tree;
+            TestPassed;
+        }},
+        {"Removing adjust case 6 [0 childs, left node]", []() {
+            IntTree* tree = new IntTree();
+            tree->insert(5);
             tree->insert(1);
+            tree->insert(7);
+            tree->insert(8);
+            tree->insert(9);
+            tree->insert(10);
+
+            tree->remove(7);
             AssertTrue(tree->invariant());
 
+            AssertFalse(tree->contains(7));
             AssertTrue(tree->contains(5));
-            AssertTrue(tree->contains(2));
-            AssertTrue(tree->contains(7));
             AssertTrue(tree->contains(1));
-            AssertEquals("└── 5 (B)\n    ├── 2 (B)\n    │   └── 1 (R)\n    └── 7 (B)\n", tree->toString());
+            AssertTrue(tree->contains(8));
+            AssertTrue(tree->contains(9));
+            AssertTrue(tree->contains(10));
+            AssertEquals("└── 5 (B)\n    ├── 1 (B)\n    └── 9 (R)\n        ├── 8 (B)\n        └── 10 (B)\n", tree->toString());
 
             delete tree;
             TestPassed;
         }},
-        {"Inserting adjust case 4 [right child, no uncle]", []() {
-            //case: parent red and no uncle (black) with node as right child
+        {"Removing adjust case 6 [0 childs, right node]", []() {
             IntTree* tree = new IntTree();
+            tree->insert(5);
             tree->insert(3);
-            AssertTrue(tree->invariant());
+            tree->insert(7);
+            tree->insert(2);
 
-            tree->insert(1);
+            tree->remove(7);
             AssertTrue(tree->invariant());
 
-            tree->insert(7);
-            AssertTrue(tree->invariant());
+            AssertFalse(tree->contains(7));
+            AssertTrue(tree->contains(5));
+            AssertTrue(tree->contains(3));
+            AssertTrue(tree->contains(2));
+            AssertEquals("└── 3 (B)\n    ├── 2 (B)\n    └── 5 (B)\n", tree->toString());
 
-            tree->insert(9);
-            AssertTrue(tree->invariant());
+            delete tree;
+            TestPassed;
+        }},
+        {"Removing 20 elements (random)", []() {
+            return randomRemove(20);
+        }},
+        {"Removing 50 elements (random)", []() {
+            return randomRemove(50);
+        }},
+        {"Removing 100 elements (random)", []() {
+            return randomRemove(100);
+        }},
+        {"Removing 1000 elements (random)", []() {
+            return randomRemove(1000);
+        }},
+        {"Iterator test [empty tree]", []() {
+            IntTree* tree = new IntTree();
+            bool foundElement = false;
+            
+            for (IntTree::iterator it = tree->begin(); it != tree->end(); ++it) {
+                foundElement = true;
+            }
+            
+            if (tree->begin() != tree->end()) {
+                return false;
+            }
+            
+            AssertFalse(foundElement);
+            
+            delete tree;
+            TestPassed;
+        }},
+        {"Iterator test [1 element]", []() {
+            IntTree* tree = new IntTree();
+            tree->insert(1);
+            
+            int elemCount = 0;
+            int number = 0;
+            
+            for (IntTree::iterator it = tree->begin(); it != tree->end(); ++it) {
+                number = *it;
+                elemCount++;
+            }
+            
+            AssertEquals(1, elemCount);
+            AssertEquals(1, number);
+            
+            delete tree;
+            TestPassed;
+        }},
+        {"Iterator random values [0..100 elements]", []() {
+            //Test with different amounts of elements
+            for (int i = 0; i < 100; i++) {
+                if (!randomIterate(i)) {
+                    return false;
+                }
+            }
+            
+            TestPassed;
+        }},
+        {"Iterator order [in-order traversal]", []() {
+            IntTree* tree = new IntTree();
+            int numbers[1000];
+            
+            for (int i = 0; i < 1000; i++) {
+                numbers[i] = i;
+            }
+            
+            random_shuffle(numbers, numbers+1000);
 
-            tree->insert(8);
-            AssertTrue(tree->invariant());
+            for (int i = 0; i < 1000; i++) {
+                tree->insert(numbers[i]);
+            }
+
+            int expected = 0;
 
-            AssertTrue(tree->contains(3));
-            AssertTrue(tree->contains(1));
-            AssertTrue(tree->contains(7));
-            AssertTrue(tree->contains(9));
-            AssertTrue(tree->contains(8));
-            AssertEquals("└── 3 (B)\n    ├── 1 (B)\n    └── 8 (B)\n        ├── 7 (R)\n        └── 9 (R)\n", tree->toString());
+            for (IntTree::iterator it = tree->begin(); it != tree->end(); ++it) {
+                AssertEquals(expected, *it);
+                expected++;
+            }
+
+            AssertEquals(1000, expected);
 
             delete tree;
             TestPassed;
         }},
-        {"Inserting adjust case 4 [right child, with uncle]", []() {
-            //case: parent red and uncle (black) with node as right child
+        {"Find and lower bound", []() {
             IntTree* tree = new IntTree();
-            tree->insert(5);
-            AssertTrue(tree->invariant());
-
-            tree->insert(10);
-            AssertTrue(tree->invariant());
 
-            tree->insert(6);
-            AssertTrue(tree->invariant());
-
-            tree->insert(17);
-            AssertTrue(tree->invariant());
+            for (int i = 0; i < 100; i += 10) {
+                tree->insert(i);
+            }
 
-            tree->insert(18);
-            AssertTrue(tree->invariant());
+            AssertEquals(30, *tree->find(30));
+            AssertTrue((tree->find(35) == tree->end()));
+            AssertEquals(30, *tree->lower_bound(30));
+            AssertEquals(40, *tree->lower_bound(31));
+            AssertEquals(0, *tree->lower_bound(-5));
+            AssertTrue((tree->lower_bound(91) == tree->end()));
 
-            tree->insert(7);
+            delete tree;
+            TestPassed;
+        }},
+        {"Transparent lookup [string keys]", []() {
+            StringTree* tree = new StringTree();
+            tree->insert("delta");
+            tree->insert("alpha");
+            tree->insert("charlie");
+            tree->insert("bravo");
             AssertTrue(tree->invariant());
 
-            tree->insert(8);
-            AssertTrue(tree->invariant());
+            AssertTrue(tree->contains("alpha"));
+            AssertTrue(tree->contains(string("bravo")));
+            AssertFalse(tree->contains("echo"));
+            AssertEquals("charlie", *tree->find("charlie"));
+            AssertEquals("charlie", *tree->lower_bound("c"));
+            AssertTrue((tree->lower_bound("e") == tree->end()));
 
-            //only here uncle is not null
-            tree->insert(14);
+            AssertTrue(tree->remove("alpha"));
+            AssertFalse(tree->remove("alpha"));
+            AssertFalse(tree->contains("alpha"));
             AssertTrue(tree->invariant());
 
-            AssertTrue(tree->contains(5));
-            AssertTrue(tree->contains(10));
-            AssertTrue(tree->contains(6));
-            AssertTrue(tree->contains(17));
-            AssertTrue(tree->contains(18));
-            AssertTrue(tree->contains(7));
-            AssertTrue(tree->contains(8));
-            AssertTrue(tree->contains(14));
-            AssertEquals("└── 8 (B)\n    ├── 6 (R)\n    │   ├── 5 (B)\n    │   └── 7 (B)\n    └── 17 (R)\n        ├── 10 (B)\n        │   └── 14 (R)\n        └── 18 (B)\n", tree->toString());
-
             delete tree;
             TestPassed;
         }},
-        {"Inserting adjust case 5 [left child, no uncle]", []() {
-            //case: parent red and no uncle (black) with node as left child
-            IntTree* tree = new IntTree();
+        {"Removing 1000 elements (random, string keys)", []() {
+            return randomStringRemove(1000);
+        }},
+        {"Multiset duplicates [in-node count]", []() {
+            IntMultiTree* tree = new IntMultiTree();
             tree->insert(5);
-            AssertTrue(tree->invariant());
-
             tree->insert(3);
+            tree->insert(5);
+            tree->insert(5);
             AssertTrue(tree->invariant());
 
-            tree->insert(7);
-            AssertTrue(tree->invariant());
+            AssertEquals(3u, tree->count(5));
+            AssertEquals(1u, tree->count(3));
+            AssertEquals(0u, tree->count(7));
+            AssertEquals("└── 5 (B) x3\n    └── 3 (R)\n", tree->toString());
 
-            tree->insert(1);
+            AssertTrue(tree->remove(5));
+            AssertEquals(2u, tree->count(5));
+            AssertEquals("└── 5 (B) x2\n    └── 3 (R)\n", tree->toString());
+
+            AssertTrue(tree->remove(5));
+            AssertTrue(tree->remove(5));
+            AssertFalse(tree->remove(5));
+            AssertFalse(tree->contains(5));
             AssertTrue(tree->invariant());
 
+            delete tree;
+            TestPassed;
+        }},
+        {"Multiset iterator [multiplicity]", []() {
+            IntMultiTree* tree = new IntMultiTree();
+            tree->insert(2);
+            tree->insert(1);
+            tree->insert(2);
+            tree->insert(3);
+            tree->insert(1);
             tree->insert(2);
-            AssertTrue(tree->invariant());
 
-            AssertTrue(tree->contains(5));
-            AssertTrue(tree->contains(3));
-            AssertTrue(tree->contains(7));
-            AssertTrue(tree->contains(1));
-            AssertTrue(tree->contains(2));
-            AssertEquals("└── 5 (B)\n    ├── 2 (B)\n    │   ├── 1 (R)\n    │   └── 3 (R)\n    └── 7 (B)\n", tree->toString());
+            int expected[] = {1, 1, 2, 2, 2, 3};
+            int elemCount = 0;
+
+            for (IntMultiTree::iterator it = tree->begin(); it != tree->end(); ++it) {
+                AssertEquals(expected[elemCount], *it);
+                elemCount++;
+            }
+
+            AssertEquals(6, elemCount);
 
             delete tree;
             TestPassed;
         }},
-        {"Inserting adjust case 5 [left child, with uncle]", []() {
-            //case: parent red and uncle (black) with node as left child
+        {"Multiset random operations", []() {
+            return randomMultiset(200);
+        }},
+        {"Range erase [split and join]", []() {
             IntTree* tree = new IntTree();
-            tree->insert(16);
-            AssertTrue(tree->invariant());
 
-            tree->insert(18);
-            AssertTrue(tree->invariant());
+            for (int i = 0; i < 100; i++) {
+                tree->insert(i);
+            }
 
-            tree->insert(19);
+            AssertEquals(20u, tree->erase_range(10, 30));
             AssertTrue(tree->invariant());
-
-            tree->insert(2);
+            AssertTrue(tree->contains(9));
+            AssertFalse(tree->contains(10));
+            AssertFalse(tree->contains(29));
+            AssertTrue(tree->contains(30));
+
+            AssertEquals(0u, tree->erase_range(50, 50));
+            AssertEquals(0u, tree->erase_range(10, 30));
+            AssertEquals(10u, tree->erase_range(-5, 10));
+            AssertEquals(70u, tree->erase_range(0, 1000));
             AssertTrue(tree->invariant());
+            AssertTrue((tree->begin() == tree->end()));
 
-            tree->insert(3);
-            AssertTrue(tree->invariant());
+            delete tree;
+            TestPassed;
+        }},
+        {"Range erase [iterators]", []() {
+            IntTree* tree = new IntTree();
 
-            tree->insert(8);
-            AssertTrue(tree->invariant());
+            for (int i = 0; i < 50; i++) {
+                tree->insert(i);
+            }
 
-            tree->insert(11);
+            IntTree::iterator it = tree->erase(tree->find(10), tree->find(20));
+            AssertEquals(20, *it);
             AssertTrue(tree->invariant());
 
-            //only here uncle is not null
-            tree->insert(15);
+            it = tree->erase(tree->lower_bound(40), tree->end());
+            AssertTrue((it == tree->end()));
             AssertTrue(tree->invariant());
 
-            AssertTrue(tree->contains(16));
-            AssertTrue(tree->contains(18));
-            AssertTrue(tree->contains(19));
-            AssertTrue(tree->contains(2));
-            AssertTrue(tree->contains(3));
-            AssertTrue(tree->contains(8));
-            AssertTrue(tree->contains(11));
-            AssertTrue(tree->contains(15));
-            AssertEquals("└── 11 (B)\n    ├── 3 (R)\n    │   ├── 2 (B)\n    │   └── 8 (B)\n    └── 18 (R)\n        ├── 16 (B)\n        │   └── 15 (R)\n        └── 19 (B)\n", tree->toString());
+            int elemCount = 0;
+            for (it = tree->begin(); it != tree->end(); ++it) {
+                AssertTrue((*it < 10 || (*it >= 20 && *it < 40)));
+                elemCount++;
+            }
+
+            AssertEquals(30, elemCount);
 
             delete tree;
             TestPassed;
         }},
-        {"Inserting 20 elements (sorted)", []() {
-            return sortedInsert(20);
-        }},
-        {"Inserting 20 elements (random)", []() {
-            return randomInsert(20);
-        }},
-        {"Inserting 50 elements (sorted)", []() {
-            return sortedInsert(50);
-        }},
-        {"Inserting 50 elements (random)", []() {
-            return randomInsert(50);
-        }},
-        {"Inserting 100 elements (random)", []() {
-            return randomInsert(100);
-        }},
-        {"Inserting 1000 elements (random)", []() {
-            return randomInsert(1000);
-        }},
-        {"Inserting 1 Mio elements (random)", []() {
-            return randomInsert(1000000, false, false);
+        {"Range erase 1000 elements (random)", []() {
+            return randomRangeErase(1000);
         }},
-        {"Removing the root node", []() {
-            IntTree* tree = new IntTree();
-            tree->insert(5);
-            tree->remove(5);
-            AssertTrue(tree->invariant());
+        {"Range erase [multiset]", []() {
+            IntMultiTree* tree = new IntMultiTree();
 
-            AssertFalse(tree->contains(5));
-            AssertEquals("empty tree", tree->toString());
+            for (int i = 0; i < 3; i++) {
+                tree->insert(1);
+                tree->insert(2);
+                tree->insert(3);
+            }
+
+            //Starts at the second copy of 1 and ends at the third copy of 3
+            IntMultiTree::iterator first = ++tree->begin();
+            IntMultiTree::iterator last = tree->find(3);
+            ++last;
+            ++last;
+
+            tree->erase(first, last);
+            AssertTrue(tree->invariant());
+            AssertEquals(1u, tree->count(1));
+            AssertEquals(0u, tree->count(2));
+            AssertEquals(1u, tree->count(3));
 
             delete tree;
             TestPassed;
         }},
-        {"Removing a red leaf [0 childs]", []() {
-            IntTree* tree = new IntTree();
-            tree->insert(5);
-            tree->insert(1);
-            tree->insert(7);
+        {"Predicate erase [rebuild]", []() {
+            for (int amount = 0; amount < 200; amount++) {
+                IntTree* tree = new IntTree();
 
-            tree->remove(7);
-            AssertTrue(tree->invariant());
+                for (int i = 0; i < amount; i++) {
+                    tree->insert(i);
+                }
 
-            AssertFalse(tree->contains(7));
-            AssertTrue(tree->contains(5));
-            AssertTrue(tree->contains(1));
-            AssertEquals("└── 5 (B)\n    └── 1 (R)\n", tree->toString());
+                AssertEquals((size_t)(amount / 2), tree->erase_if([](int key) { return key % 2 == 1; }));
+                AssertTrue(tree->invariant());
+
+                for (int i = 0; i < amount; i++) {
+                    AssertEquals((i % 2 == 0), tree->contains(i));
+                }
+
+                //The rebuilt tree has to support the usual operations
+                tree->insert(amount);
+                tree->remove(0);
+                AssertTrue(tree->invariant());
+
+                delete tree;
+            }
 
-            delete tree;
             TestPassed;
         }},
-        {"Removing a black node with red child [1 child]", []() {
+        {"Node handles [extract and insert]", []() {
             IntTree* tree = new IntTree();
-            tree->insert(5);
-            tree->insert(1);
-            tree->insert(7);
-            tree->insert(3);
+            IntTree* other = new IntTree();
 
-            tree->remove(1);
-            AssertTrue(tree->invariant());
+            for (int i = 0; i < 10; i++) {
+                tree->insert(i);
+            }
 
-            AssertFalse(tree->contains(1));
-            AssertTrue(tree->contains(5));
-            AssertTrue(tree->contains(7));
-            AssertTrue(tree->contains(3));
-            AssertEquals("└── 5 (B)\n    ├── 3 (B)\n    └── 7 (B)\n", tree->toString());
+            other->insert(3);
+
+            //A key that exists in the target stays in the handle
+            IntTree::node_type handle = tree->extract(3);
+            AssertFalse(tree->contains(3));
+            AssertFalse(other->insert(std::move(handle)));
+            AssertFalse(handle.empty());
+
+            //The key of a handle can be changed before it is inserted
+            handle.value() = 42;
+            AssertTrue(other->insert(std::move(handle)));
+            AssertTrue(other->contains(42));
+            AssertTrue(other->invariant());
+
+            //Extracting the root with two childs
+            handle = tree->extract(tree->find(*tree->begin()));
+            AssertEquals(0, handle.value());
+            AssertTrue(tree->extract(100).empty());
+            AssertTrue(tree->invariant());
 
             delete tree;
+            delete other;
             TestPassed;
         }},
-        {"Removing black leaf [0 childs]", []() {
+        {"Node handles 1000 elements (random)", []() {
+            return randomExtract(1000);
+        }},
+        {"Merge trees [duplicates stay]", []() {
             IntTree* tree = new IntTree();
-            tree->insert(1);
-            tree->insert(2);
-            tree->insert(3);
-            tree->insert(4);
+            IntTree* other = new IntTree();
 
-            //remove 3 to get a completly black tree
-            tree->remove(3);
-            AssertTrue(tree->invariant());
+            for (int i = 0; i < 100; i += 2) {
+                tree->insert(i);
+            }
 
-            tree->remove(4);
+            for (int i = 0; i < 100; i += 3) {
+                other->insert(i);
+            }
+
+            const int* address = &*other->find(3);
+            tree->merge(*other);
             AssertTrue(tree->invariant());
+            AssertTrue(other->invariant());
+            AssertTrue((address == &*tree->find(3)));
 
-            AssertFalse(tree->contains(3));
-            AssertFalse(tree->contains(4));
-            AssertTrue(tree->contains(1));
-            AssertTrue(tree->contains(2));
-            AssertEquals("└── 2 (B)\n    └── 1 (R)\n", tree->toString());
+            for (int i = 0; i < 100; i++) {
+                AssertEquals((i % 2 == 0 || i % 3 == 0), tree->contains(i));
+                AssertEquals((i % 6 == 0), other->contains(i));
+            }
 
             delete tree;
+            delete other;
             TestPassed;
         }},
-        {"Removing node with 1 child [red child]", []() {
-            IntTree* tree = new IntTree();
+        {"Merge trees [multiset]", []() {
+            IntMultiTree* tree = new IntMultiTree();
+            IntMultiTree* other = new IntMultiTree();
+
             tree->insert(1);
             tree->insert(2);
-            tree->insert(3);
-            tree->insert(4);
+            other->insert(2);
+            other->insert(2);
+            other->insert(3);
 
-            tree->remove(3);
+            tree->merge(*other);
             AssertTrue(tree->invariant());
+            AssertTrue((other->begin() == other->end()));
+            AssertEquals(1u, tree->count(1));
+            AssertEquals(3u, tree->count(2));
+            AssertEquals(1u, tree->count(3));
 
-            AssertFalse(tree->contains(3));
-            AssertTrue(tree->contains(1));
-            AssertTrue(tree->contains(2));
-            AssertTrue(tree->contains(4));
-            AssertEquals("└── 2 (B)\n    ├── 1 (B)\n    └── 4 (B)\n", tree->toString());
+            IntMultiTree::node_type handle = tree->extract(2);
+            AssertEquals(3u, handle.count());
+            AssertFalse(tree->contains(2));
 
             delete tree;
+            delete other;
             TestPassed;
         }},
-        {"Removing node with 2 childs [root node]", []() {
-            IntTree* tree = new IntTree();
-            tree->insert(1);
-            tree->insert(2);
-            tree->insert(3);
-            tree->insert(4);
+        {"Copy constructor [structural clone]", []() {
+            IntMultiTree* tree = new IntMultiTree();
 
-            //remove 4 to get black childs for the root
-            tree->remove(4);
-            AssertTrue(tree->invariant());
+            for (int i = 0; i < 100; i++) {
+                tree->insert(i % 40);
+            }
 
-            tree->remove(2);
-            AssertTrue(tree->invariant());
+            IntMultiTree* copy = new IntMultiTree(*tree);
+            AssertTrue(copy->invariant());
+            AssertEquals(tree->toString(), copy->toString());
 
-            AssertFalse(tree->contains(4));
-            AssertFalse(tree->contains(2));
-            AssertTrue(tree->contains(1));
-            AssertTrue(tree->contains(3));
-            AssertEquals("└── 3 (B)\n    └── 1 (R)\n", tree->toString());
+            //The trees are independent
+            copy->insert(100);
+            copy->remove(5);
+            AssertFalse(tree->contains(100));
+            AssertEquals(3u, tree->count(5));
+            AssertEquals(2u, copy->count(5));
+
+            //A cloned node outlives its tree in a handle
+            IntMultiTree::node_type handle = copy->extract(7);
+            delete copy;
+
+            AssertEquals(7, handle.value());
+            AssertTrue(tree->insert(std::move(handle)));
+            AssertEquals(6u, tree->count(7));
+            AssertTrue(tree->invariant());
 
             delete tree;
             TestPassed;
         }},
-        {"Removing adjust case 1 [0 childs, root node]", []() {
-            IntTree* tree = new IntTree();
-            tree->insert(7);
-            tree->remove(7);
-            AssertTrue(tree->invariant());
+        {"Copy constructor 10000 elements (random)", []() {
+            return randomClone(10000);
+        }},
+        {"Copy constructor of small trees", []() {
+            //Single nodes, the first block and growing blocks
+            const int sizes[] = {1, 2, 31, 32, 33, 65, 300};
 
-            AssertFalse(tree->contains(7));
-            AssertEquals("empty tree", tree->toString());
+            for (int i = 0; i < 7; i++) {
+                if (!randomClone(sizes[i])) return false;
+            }
 
-            delete tree;
             TestPassed;
         }},
-        {"Removing adjust case 2 [0 childs, left node]", []() {
-            IntTree* tree = new IntTree();
-            tree->insert(3);
-            tree->insert(2);
-            tree->insert(5);
-            tree->insert(7);
-            tree->insert(8);
-            tree->insert(9);
+        {"Copy and move assignment", []() {
+            IntTree tree;
+            IntTree other;
 
-            tree->remove(2);
-            AssertTrue(tree->invariant());
+            for (int i = 0; i < 20; i++) {
+                tree.insert(i);
+            }
+
+            other.insert(100);
+            other = tree;
+            AssertTrue(other.invariant());
+            AssertFalse(other.contains(100));
+            AssertTrue(other.contains(19));
+
+            other = other;
+            AssertTrue(other.contains(19));
+
+            IntTree moved(std::move(other));
+            AssertTrue(moved.contains(19));
+            AssertTrue((other.begin() == other.end()));
+
+            other.insert(50);
+            other = std::move(moved);
+            AssertTrue(other.contains(19));
+            AssertFalse(other.contains(50));
 
-            AssertFalse(tree->contains(2));
-            AssertTrue(tree->contains(3));
-            AssertTrue(tree->contains(5));
-            AssertTrue(tree->contains(7));
-            AssertTrue(tree->contains(8));
-            AssertTrue(tree->contains(9));
-            AssertEquals("└── 7 (B)\n    ├── 3 (B)\n    │   └── 5 (R)\n    └── 8 (B)\n        └── 9 (R)\n", tree->toString());
+            swap(tree, moved);
+            AssertTrue(moved.contains(19));
+            AssertTrue(tree.contains(50));
+            AssertTrue(moved.invariant());
 
-            delete tree;
             TestPassed;
         }},
-        {"Removing adjust case 2 [0 childs, right node]", []() {
-            IntTree* tree = new IntTree();
-            tree->insert(8);
-            tree->insert(6);
-            tree->insert(7);
-            tree->insert(1);
-            tree->insert(4);
-            tree->insert(3);
+        {"Clear", []() {
+            IntMultiTree tree;
+            AssertTrue(tree.empty());
+            tree.clear();
 
-            //same case when deleting the 7 (is root with 2 childs)
-            tree->remove(8);
-            AssertTrue(tree->invariant());
+            for (int i = 0; i < 10000; i++) {
+                tree.insert(i % 100);
+            }
 
-            AssertFalse(tree->contains(8));
-            AssertTrue(tree->contains(6));
-            AssertTrue(tree->contains(7));
-            AssertTrue(tree->contains(1));
-            AssertTrue(tree->contains(4));
-            AssertTrue(tree->contains(3));
-            AssertEquals("└── 4 (B)\n    ├── 1 (B)\n    │   └── 3 (R)\n    └── 7 (B)\n        └── 6 (R)\n", tree->toString());
+            tree.clear();
+            AssertTrue(tree.empty());
+            AssertTrue(tree.invariant());
+            AssertTrue((tree.begin() == tree.end()));
 
-            delete tree;
+            //The tree is usable after clear
+            tree.insert(5);
+            tree.insert(5);
+            AssertEquals(2u, tree.count(5));
+            AssertTrue(tree.invariant());
             TestPassed;
         }},
-        {"Removing adjust case 3 [0 childs, symmetric]", []() {
-            IntTree* tree = new IntTree();
-            tree->insert(2);
-            tree->insert(19);
-            tree->insert(3);
-            tree->insert(6);
-            tree->insert(7);
-            tree->insert(10);
-            tree->insert(11);
-            tree->insert(18);
-            tree->insert(17);
-            tree->insert(20);
+        {"Deferred destruction", []() {
+            RBTree<TrackedKey>* tree = new RBTree<TrackedKey>();
+            tree->setDeferredDestruction(true);
+            AssertTrue(tree->deferredDestruction());
 
-            //same case when deleting the 3 (with 2 childs)
-            tree->remove(6);
-            AssertTrue(tree->invariant());
+            for (int i = 0; i < 10000; i++) {
+                tree->insert(TrackedKey(i));
+            }
 
-            AssertFalse(tree->contains(6));
-            AssertTrue(tree->contains(2));
-            AssertTrue(tree->contains(19));
-            AssertTrue(tree->contains(3));
-            AssertTrue(tree->contains(7));
-            AssertTrue(tree->contains(10));
-            AssertTrue(tree->contains(11));
-            AssertTrue(tree->contains(18));
-            AssertTrue(tree->contains(17));
-            AssertTrue(tree->contains(20));
+            AssertEquals(10000, TrackedKey::live.load());
+            tree->clear();
+            AssertTrue(tree->empty());
 
+            tree->insert(TrackedKey(1));
+            AssertTrue(tree->contains(TrackedKey(1)));
+            RBTree<TrackedKey> copy(*tree);
+            AssertTrue(copy.deferredDestruction());
             delete tree;
+
+            RBTreeReclaimer::instance().wait();
+            AssertEquals(1, TrackedKey::live.load());
             TestPassed;
         }},
-        {"Removing adjust case 4 [0 childs, symmetric]", []() {
-            IntTree* tree = new IntTree();
-            tree->insert(7);
-            tree->insert(8);
-            tree->insert(3);
-            tree->insert(4);
-            tree->insert(5);
-            tree->insert(2);
+        {"Parallel for each", []() {
+            IntMultiTree tree;
+            atomic<long> sum(0);
+            atomic<int> calls(0);
+            long expected = 0;
+
+            tree.parallel_for_each([&](int) { calls++; }, 4);
+            AssertEquals(0, calls.load());
+
+            for (int i = 0; i < 10000; i++) {
+                tree.insert(i % 3000);
+                expected += i % 3000;
+            }
 
-            tree->remove(8);
-            AssertTrue(tree->invariant());
+            parallel_for_each(tree, [&](int key) {
+                sum += key;
+                calls++;
+            }, 4);
 
-            AssertFalse(tree->contains(8));
-            AssertTrue(tree->contains(7));
-            AssertTrue(tree->contains(3));
-            AssertTrue(tree->contains(4));
-            AssertTrue(tree->contains(5));
-            AssertTrue(tree->contains(2));
-            AssertEquals("└── 4 (B)\n    ├── 3 (B)\n    │   └── 2 (R)\n    └── 7 (B)\n        └── 5 (R)\n", tree->toString());
+            AssertEquals(expected, sum.load());
+            AssertEquals(10000, calls.load());
 
-            delete tree;
+            //Exceptions of the workers are passed on
+            bool thrown = false;
+
+            try {
+                tree.parallel_for_each([](int key) {
+                    if (key == 2500) throw key;
+                }, 4);
+            } catch (int key) {
+                thrown = (key == 2500);
+            }
+
+            AssertTrue(thrown);
             TestPassed;
         }},
-        {"Removing adjust case 5 [0 childs, right sibling child red]", []() {
-            IntTree* tree = new IntTree();
-            tree->insert(5);
-            tree->insert(1);
-            tree->insert(7);
-            tree->insert(2);
+        {"Parallel reduce [in-order]", []() {
+            StringTree tree;
+            string expected;
 
-            tree->remove(7);
-            AssertTrue(tree->invariant());
+            for (int i = 0; i < 1000; i++) {
+                tree.insert(to_string(i));
+            }
 
-            AssertFalse(tree->contains(7));
-            AssertTrue(tree->contains(5));
-            AssertTrue(tree->contains(1));
-            AssertTrue(tree->contains(2));
-            AssertEquals("└── 2 (B)\n    ├── 1 (B)\n    └── 5 (B)\n", tree->toString());
+            for (StringTree::iterator it = tree.begin(); it != tree.end(); ++it) {
+                expected += *it;
+            }
 
-            delete tree;
+            //Concatenation is not commutative, so the order must be kept
+            auto append = [](const string& text, const string& key) { return text + key; };
+            string concat = tree.parallel_reduce(string(), append, append, 8);
+            AssertEquals(expected, concat);
+
+            size_t length = parallel_reduce(tree, (size_t)0,
+                [](size_t total, const string& key) { return total + key.size(); },
+                [](size_t a, size_t b) { return a + b; }, 3);
+
+            AssertEquals(expected.size(), length);
+            AssertEquals(7, (RBTree<int>().parallel_reduce(7, std::plus<int>(), std::plus<int>())));
             TestPassed;
         }},
-        {"Removing adjust case 5 [0 childs, left sibling child red]", []() {
-            IntTree* tree = new IntTree();
-            tree->insert(5);
-            tree->insert(1);
-            tree->insert(10);
-            tree->insert(7);
-            tree->insert(12);
-            tree->insert(11);
+        {"Parallel construction", []() {
+            IntTree tree;
+            vector<int> empty;
+            tree.insert(1);
+            tree.assign_parallel(empty.begin(), empty.end(), 4);
+            AssertTrue(tree.empty());
+
+            //The top levels and the subtrees are linked in different steps
+            for (unsigned int threads = 1; threads <= 16; threads *= 2) {
+                if (!randomParallelBuild(20000, threads)) {
+                    return false;
+                }
+            }
 
-            tree->remove(7);
-            AssertTrue(tree->invariant());
+            //The own keys can be assigned again
+            int keys[] = {5, 3, 9, 3, 1};
+            tree.assign_parallel(keys, keys + 5, 3);
+            tree.assign_parallel(tree.begin(), tree.end(), 3);
+            string text;
 
-            AssertFalse(tree->contains(7));
-            AssertTrue(tree->contains(5));
-            AssertTrue(tree->contains(1));
-            AssertTrue(tree->contains(10));
-            AssertTrue(tree->contains(12));
-            AssertTrue(tree->contains(11));
-            AssertEquals("└── 5 (B)\n    ├── 1 (B)\n    └── 11 (R)\n        ├── 10 (B)\n        └── 12 (B)\n", tree->toString());
+            for (IntTree::iterator it = tree.begin(); it != tree.end(); ++it) {
+                text += to_string(*it) + " ";
+            }
 
-            delete tree;
+            AssertEquals(string("1 3 5 9 "), text);
+            AssertTrue(tree.invariant());
             TestPassed;
         }},
-        {"Removing adjust case 6 [0 childs, left node]", []() {
-            IntTree* tree = new IntTree();
-            tree->insert(5);
-            tree->insert(1);
-            tree->insert(7);
-            tree->insert(8);
-            tree->insert(9);
-            tree->insert(10);
+        {"Parallel construction [multiset]", []() {
+            IntMultiTree tree;
+            vector<int> keys;
 
-            tree->remove(7);
-            AssertTrue(tree->invariant());
+            for (int i = 0; i < 50000; i++) {
+                keys.push_back(i % 700);
+            }
 
-            AssertFalse(tree->contains(7));
-            AssertTrue(tree->contains(5));
-            AssertTrue(tree->contains(1));
-            AssertTrue(tree->contains(8));
-            AssertTrue(tree->contains(9));
-            AssertTrue(tree->contains(10));
-            AssertEquals("└── 5 (B)\n    ├── 1 (B)\n    └── 9 (R)\n        ├── 8 (B)\n        └── 10 (B)\n", tree->toString());
+            random_shuffle(keys.begin(), keys.end());
+            tree.assign_parallel(keys.begin(), keys.end(), 8);
+            AssertTrue(tree.invariant());
 
-            delete tree;
+            for (int i = 0; i < 700; i++) {
+                AssertEquals(((i < 300) ? 72u : 71u), tree.count(i));
+            }
+
+            AssertTrue(tree.remove(5));
+            AssertEquals(71u, tree.count(5));
             TestPassed;
         }},
-        {"Removing adjust case 6 [0 childs, right node]", []() {
-            IntTree* tree = new IntTree();
-            tree->insert(5);
-            tree->insert(3);
-            tree->insert(7);
-            tree->insert(2);
+        {"Threaded tree [links]", []() {
+            IntThreadedTree tree;
 
-            tree->remove(7);
-            AssertTrue(tree->invariant());
-
-            AssertFalse(tree->contains(7));
-            AssertTrue(tree->contains(5));
-            AssertTrue(tree->contains(3));
-            AssertTrue(tree->contains(2));
-            AssertEquals("└── 3 (B)\n    ├── 2 (B)\n    └── 5 (B)\n", tree->toString());
+            for (int i = 0; i < 100; i++) {
+                tree.insert((i * 37) % 100);
+            }
 
-            delete tree;
+            AssertTrue(tree.invariant());
+            IntThreadedTree::iterator it = tree.find(50);
+            AssertEquals(51, *(++it));
+            AssertEquals(50, *(--it));
+            AssertEquals(49, *(--it));
+
+            //Removing a node with two childs swaps it with its successor
+            AssertTrue(tree.remove(0));
+            AssertTrue(tree.remove(49));
+            AssertTrue(tree.invariant());
+            AssertEquals(51, *(++tree.find(50)));
+            AssertEquals(48, *(--tree.find(50)));
+
+            vector<int> keys(1000);
+            for (int i = 0; i < 1000; i++) keys[i] = 999 - i;
+            tree.assign_parallel(keys.begin(), keys.end(), 4);
+            AssertTrue(tree.invariant());
+            AssertEquals(1000u, (unsigned int)distance(tree.begin(), tree.end()));
             TestPassed;
         }},
-        {"Removing 20 elements (random)", []() {
-            return randomRemove(20);
+        {"Threaded tree 2000 elements (random)", []() {
+            return randomThreaded(2000);
         }},
-        {"Removing 50 elements (random)", []() {
-            return randomRemove(50);
+        {"Iterator decrement [multiset]", []() {
+            IntMultiTree tree;
+            tree.insert(1);
+            tree.insert(2);
+            tree.insert(2);
+            tree.insert(3);
+
+            IntMultiTree::iterator it = tree.find(3);
+            AssertEquals(2, *(--it));
+            AssertEquals(2, *(--it));
+            AssertEquals(1, *(--it));
+            AssertTrue(((--it) == tree.end()));
+            TestPassed;
         }},
-        {"Removing 100 elements (random)", []() {
-            return randomRemove(100);
+        {"Top-down tree [insert, remove, iterate]", []() {
+            RBTopDownTree<string> tree;
+            AssertTrue(tree.invariant());
+
+            //The color needs no room of its own
+            AssertEquals(2 * sizeof(void*) + sizeof(string), RBTopDownTree<string>::nodeSize());
+            AssertEquals(2 * sizeof(void*) + sizeof(long), RBTopDownTree<long>::nodeSize());
+            AssertFalse(tree.remove("a"));
+
+            for (int i = 0; i < 200; i++) {
+                tree.insert(to_string(i));
+                AssertTrue(tree.invariant());
+            }
+
+            AssertEquals(string("57"), *tree.find("57"));
+            AssertEquals(string("58"), *(++tree.find("57")));
+            AssertTrue((tree.find("x") == tree.end()));
+            AssertEquals(1u, tree.count("99"));
+
+            //Removing the inner node moves the neighbour key into it
+            AssertTrue(tree.remove("57"));
+            AssertTrue(tree.invariant());
+            AssertFalse(tree.contains("57"));
+            AssertTrue(tree.contains("58"));
+
+            tree.clear();
+            AssertTrue(tree.empty());
+            TestPassed;
         }},
-        {"Removing 1000 elements (random)", []() {
-            return randomRemove(1000);
+        {"Top-down tree 5000 elements (random)", []() {
+            return randomTopDown(5000);
         }},
-        {"Iterator test [empty tree]", []() {
-            IntTree* tree = new IntTree();
-            bool foundElement = false;
-            
-            for (IntTree::iterator it = tree->begin(); it != tree->end(); ++it) {
-                foundElement = true;
+        {"Defragment [shape and colors]", []() {
+            IntMultiTree tree;
+            StringTree strings;
+            tree.defragment();
+
+            for (int i = 0; i < 3000; i++) {
+                tree.insert((i * 7919) % 1000);
+                strings.insert(to_string(i));
             }
-            
-            if (tree->begin() != tree->end()) {
-                return false;
+
+            string before = tree.toString();
+            tree.defragment();
+            AssertEquals(before, tree.toString());
+            AssertTrue(tree.invariant());
+            AssertEquals(3u, tree.count(999));
+
+            //The keys are moved, not copied
+            before = strings.toString();
+            strings.defragment();
+            AssertEquals(before, strings.toString());
+            AssertTrue(strings.invariant());
+
+            IntThreadedTree threaded;
+            for (int i = 0; i < 500; i++) threaded.insert(i * 3);
+            threaded.defragment();
+            AssertTrue(threaded.invariant());
+            AssertEquals(300, *(++threaded.find(297)));
+            TestPassed;
+        }},
+        {"Defragment [incremental]", []() {
+            IntThreadedTree tree;
+            AssertTrue(tree.defragment_step(10));
+
+            for (int i = 0; i < 1000; i++) {
+                tree.insert(i);
             }
-            
-            AssertFalse(foundElement);
-            
-            delete tree;
+
+            string before = tree.toString();
+            int steps = 1;
+
+            while (!tree.defragment_step(64)) {
+                steps++;
+            }
+
+            AssertEquals(16, steps);
+            AssertEquals(before, tree.toString());
+            AssertTrue(tree.invariant());
+
+            //The tree may change between the steps
+            AssertFalse(tree.defragment_step(100));
+            tree.erase_range(50, 150);
+            tree.insert(2000);
+            AssertFalse(tree.defragment_step(100));
+            AssertTrue(tree.remove(250));
+            AssertTrue(tree.invariant());
+            tree.clear();
+            AssertTrue(tree.defragment_step(100));
             TestPassed;
         }},
-        {"Iterator test [1 element]", []() {
-            IntTree* tree = new IntTree();
-            tree->insert(1);
-            
-            int elemCount = 0;
-            int number = 0;
-            
-            for (IntTree::iterator it = tree->begin(); it != tree->end(); ++it) {
-                number = *it;
-                elemCount++;
+        {"Lookup [branchless descent]", []() {
+            //Small keys take the branchless descent with any comparator
+            RBTree<long, greater<long>> tree;
+            AssertFalse(tree.contains(1));
+            AssertTrue((tree.lower_bound(1) == tree.end()));
+
+            for (long i = 0; i < 1000; i += 2) {
+                tree.insert(i);
             }
-            
-            AssertEquals(1, elemCount);
-            AssertEquals(1, number);
-            
-            delete tree;
+
+            for (long i = -1; i <= 1000; i++) {
+                AssertEquals((i >= 0 && i < 1000 && i % 2 == 0), tree.contains(i));
+            }
+
+            AssertEquals(998, *tree.lower_bound(1000));
+            AssertEquals(4, *tree.lower_bound(5));
+            AssertTrue((tree.lower_bound(-1) == tree.end()));
+            AssertEquals(10, *tree.find(10));
+            AssertTrue((tree.find(11) == tree.end()));
+            AssertTrue(tree.remove(10));
+            AssertFalse(tree.remove(10));
             TestPassed;
         }},
-        {"Iterator random values [0..100 elements]", []() {
-            //Test with different amounts of elements
-            for (int i = 0; i < 100; i++) {
-                if (!randomIterate(i)) {
-                    return false;
-                }
+        {"String keys [inline and prefix]", []() {
+            RBStringKey empty;
+            RBStringKey shortKey("short");
+            RBStringKey longKey(string("https://example.org/a/long/path"));
+
+            AssertEquals(0u, (unsigned int)empty.size());
+            AssertEquals(string("short"), shortKey.str());
+            AssertEquals(string("https://example.org/a/long/path"), longKey.str());
+
+            //Copies own their tail, moved keys are empty
+            RBStringKey copy(longKey);
+            RBStringKey moved(std::move(copy));
+            AssertTrue((moved == longKey));
+            AssertEquals(0u, (unsigned int)copy.size());
+
+            copy = shortKey;
+            AssertTrue((copy == shortKey));
+            copy = longKey;
+            AssertTrue((copy == longKey));
+
+            RBStringTree<> tree;
+            tree.insert(longKey);
+            tree.insert("https://example.org/a");
+            tree.insert(shortKey);
+
+            AssertTrue(tree.contains("short"));
+            AssertTrue(tree.contains(string("https://example.org/a/long/path")));
+            AssertFalse(tree.contains("https://example.org/a/long/pat"));
+            AssertEquals(string("https://example.org/a"), tree.begin()->str());
+            AssertTrue(tree.remove("https://example.org/a"));
+            AssertTrue(tree.invariant());
+            TestPassed;
+        }},
+        {"String keys 2000 elements (random)", []() {
+            return randomStringKeys(2000);
+        }},
+        {"Bloom filter [add, remove, saturation]", []() {
+            RBBloomFilter filter(64);
+
+            for (size_t i = 0; i < 64; i++) {
+                filter.add(i);
             }
-            
+
+            for (size_t i = 0; i < 64; i++) {
+                AssertTrue(filter.mayContain(i));
+            }
+
+            //No false negatives for the remaining keys after removals
+            for (size_t i = 0; i < 32; i++) {
+                filter.remove(i);
+            }
+
+            for (size_t i = 32; i < 64; i++) {
+                AssertTrue(filter.mayContain(i));
+            }
+
+            //Saturated counters stay set
+            RBBloomFilter saturated(64);
+
+            for (int i = 0; i < 20; i++) {
+                saturated.add(7);
+            }
+
+            for (int i = 0; i < 20; i++) {
+                saturated.remove(7);
+            }
+
+            AssertTrue(saturated.mayContain(7));
+
+            RBBloomFilter copy(filter);
+            AssertTrue(copy.mayContain(63));
+            copy.clear();
+            AssertFalse(copy.mayContain(63));
+            AssertTrue(filter.mayContain(63));
+
+            //Moves do not allocate, the moved-from filter stays usable
+            static_assert(is_nothrow_move_constructible<RBBloomFilter>::value, "noexcept move");
+            RBBloomFilter moved(std::move(filter));
+            AssertTrue(moved.mayContain(63));
+            AssertFalse(filter.mayContain(63));
+            RBBloomFilter empty(filter);
+            filter.remove(5);
+            filter.clear();
+            filter.add(5);
+            AssertTrue(filter.mayContain(5));
+            AssertFalse(empty.mayContain(5));
+            TestPassed;
+        }},
+        {"Filtered tree 20000 elements (random)", []() {
+            return randomFiltered(20000);
+        }},
+        {"Cached tree [copy and slot count]", []() {
+            IntCachedTree tree(100);
+            AssertEquals(128u, (unsigned int)tree.slotCount());
+
+            for (int i = 0; i < 50; i++) {
+                tree.insert(i);
+                AssertTrue(tree.contains(i));
+            }
+
+            //The copy has its own nodes and starts with an empty cache
+            IntCachedTree copy(tree);
+            AssertTrue(copy.invariant());
+            AssertTrue(tree.remove(10));
+            AssertTrue(copy.contains(10));
+            AssertFalse(tree.contains(10));
+
+            copy = tree;
+            AssertFalse(copy.contains(10));
+            AssertTrue(copy.invariant());
+            AssertTrue(tree.invariant());
+            TestPassed;
+        }},
+        {"Cached tree 2000 elements (random)", []() {
+            return randomCached(2000);
+        }},
+        {"Interval tree [overlap and stabbing]", []() {
+            IntIntervalTree tree;
+            tree.insert(RBInterval<int>(10, 20));
+            tree.insert(RBInterval<int>(15, 16));
+            tree.insert(RBInterval<int>(1, 100));
+            tree.insert(RBInterval<int>(30, 40));
+            tree.insert(RBInterval<int>(50, 50));
+
+            AssertEquals(100, tree.root_view().augment());
+
+            vector<int> starts;
+            stabbing(tree, 16, [&](const RBInterval<int>& interval) { starts.push_back(interval.start); });
+            AssertEquals(3u, (unsigned int)starts.size());
+            AssertEquals(1, starts[0]);
+            AssertEquals(10, starts[1]);
+            AssertEquals(15, starts[2]);
+
+            starts.clear();
+            overlapping(tree, 41, 49, [&](const RBInterval<int>& interval) { starts.push_back(interval.start); });
+            AssertEquals(1u, (unsigned int)starts.size());
+
+            //The maximum end shrinks when the longest interval is removed
+            AssertTrue(tree.remove(RBInterval<int>(1, 100)));
+            AssertEquals(50, tree.root_view().augment());
+            AssertTrue(tree.invariant());
+
+            //Two sessions with the same range are both stored and found
+            RBIntervalTree<int, unsigned int> sessions;
+            AssertTrue(sessions.insert(RBInterval<int, unsigned int>(10, 20, 7)));
+            AssertTrue(sessions.insert(RBInterval<int, unsigned int>(10, 20, 3)));
+            AssertFalse(sessions.insert(RBInterval<int, unsigned int>(10, 20, 7)));
+
+            vector<unsigned int> ids;
+            overlapping(sessions, 12, 14, [&](const RBInterval<int, unsigned int>& interval) {
+                ids.push_back(interval.value);
+            });
+
+            AssertEquals(2u, (unsigned int)ids.size());
+            AssertEquals(3u, ids[0]);
+            AssertEquals(7u, ids[1]);
+            AssertTrue(sessions.invariant());
             TestPassed;
+        }},
+        {"Interval tree 3000 elements (random)", []() {
+            return randomIntervals(3000);
+        }},
+        {"Merkle tree [ranges and empty trees]", []() {
+            IntMerkleTree first;
+            IntMerkleTree second;
+            vector<int> keys;
+
+            //Everything of a non-empty tree differs from an empty tree
+            first.insert(5);
+            first.insert(1);
+            first.insert(9);
+            diff(first, second, [&](const int& key, bool inFirst) { if (inFirst) keys.push_back(key); });
+            AssertEquals(3u, (unsigned int)keys.size());
+            AssertEquals(1, keys[0]);
+            AssertEquals(9, keys[2]);
+
+            second.insert(9);
+            second.insert(5);
+            second.insert(1);
+            AssertTrue((merkle_hash_range(first, 0, 6) == merkle_hash_range(second, 0, 6)));
+            AssertEquals(2u, (unsigned int)merkle_hash_range(first, 1, 9).count);
+
+            keys.clear();
+            diff(first, second, [&](const int& key, bool) { keys.push_back(key); });
+            AssertEquals(0u, (unsigned int)keys.size());
+            TestPassed;
+        }},
+        {"Merkle diff 5000 elements (random)", []() {
+            return randomMerkleDiff(5000, 40);
+        }},
+        {"Range insert [single inserts and rebuild]", []() {
+            return rangeInsert<IntTree>(2000, 10) && rangeInsert<IntTree>(2000, 3000) &&
+                   rangeInsert<IntTree>(0, 500);
+        }},
+        {"Range insert [multiset, threaded, augmented]", []() {
+            return rangeInsert<IntMultiTree>(2000, 3000) && rangeInsert<IntThreadedTree>(2000, 3000) &&
+                   rangeInsert<IntMerkleTree>(2000, 3000) && rangeInsert<IntMerkleTree>(2000, 10);
+        }},
+        {"Buffered tree 5000 elements (random)", []() {
+            return randomBuffered(5000, 64) && randomBuffered(5000, 100000);
+        }},
+        {"Lazy removal 5000 elements [compaction by ratio and by steps]", []() {
+            return randomLazy(5000, IntLazyTree::DEFAULT_DEAD_RATIO, 0) && randomLazy(5000, 1.0, 32) &&
+                   randomLazy(5000, 0.0, 0);
+        }},
+        {"Merge iterator [0 to 16 trees, with and without dedup]", []() {
+            return randomMerge<IntTree>(0, 100, false) && randomMerge<IntTree>(1, 2000, false) &&
+                   randomMerge<IntTree>(2, 2000, true) && randomMerge<IntTree>(7, 5000, false) &&
+                   randomMerge<IntTree>(16, 5000, true);
+        }},
+        {"Merge iterator [multiset and threaded trees]", []() {
+            return randomMerge<IntMultiTree>(5, 5000, false) && randomMerge<IntMultiTree>(5, 5000, true) &&
+                   randomMerge<IntThreadedTree>(9, 5000, true);
+        }},
+        {"Jump table 5000 elements [int, negative, 64 bit and threaded keys]", []() {
+            return randomJumpTable<IntTree>(5000, 8, 0) && randomJumpTable<IntTree>(5000, 4, -2500) &&
+                   randomJumpTable<IntTree>(5000, 12, 0) && randomJumpTable<RBTree<long long>>(5000, 6, -(1LL << 40)) &&
+                   randomJumpTable<RBTree<uint64_t>>(5000, 6, 1LL << 62) && randomJumpTable<IntThreadedTree>(5000, 6, 7);
+        }},
+        {"Slab map 5000 elements (random)", []() {
+            return randomSlabMap(5000);
+        }},
+        {"Combining tree 1000 elements [8 threads on 4 slots, 16 threads on 64 slots]", []() {
+            return randomCombining(8, 4, 1000) && randomCombining(16, 64, 1000) && randomCombining(1, 1, 1000);
+        }},
+        {"Combining tree passes comparator errors to the caller", []() {
+            return combiningError();
+        }},
+        {"Node cache with trees freed by other threads [16 threads]", []() {
+            return nodeCacheChurn(16, 50, 40);
+        }},
+        {"Static tree built at compile time", []() {
+            return staticTree();
         }}
     };
 
@@ -6,6 +6,23 @@
 #ifndef RBTREE_H
 #define RBTREE_H
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 #ifdef DEBUG
 #include <assert.h>
 #include <fstream>
@@ -15,13 +32,182 @@
 using namespace std;
 #endif
 
+//Multiplicity of the key in a node, only multisets store a counter
+template<bool Multi>
+struct RBTreeNodeCount {
+    inline unsigned int getCount() const { return 1; }
+    inline void setCount(unsigned int) {}
+};
+
+template<>
+struct RBTreeNodeCount<true> {
+    unsigned int count = 1;
+
+    inline unsigned int getCount() const { return count; }
+    inline void setCount(unsigned int count) { this->count = count; }
+};
+
+//Background thread that frees the detached nodes of trees in deferred
+//destruction mode. The instance is never deleted, so trees with static
+//storage duration can still hand over their nodes at program exit.
+class RBTreeReclaimer {
+private:
+    typedef size_t (*Destroy)(void* root);
+
+    struct Task {
+        void* root;
+        Destroy destroy;
+    };
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::condition_variable idle;
+    std::deque<Task> tasks;
+    bool running;
+    size_t busy;
+
+    RBTreeReclaimer() : running(false), busy(0) {}
+    void run();
+
+public:
+    RBTreeReclaimer(const RBTreeReclaimer&) = delete;
+    RBTreeReclaimer& operator= (const RBTreeReclaimer&) = delete;
+
+    static RBTreeReclaimer& instance();
+
+    //Queues the root, the worker thread is started with the first task
+    void retire(void* root, Destroy destroy);
+
+    //Blocks until all queued trees are freed
+    void wait();
+};
+
+inline RBTreeReclaimer& RBTreeReclaimer::instance() {
+    static RBTreeReclaimer* reclaimer = new RBTreeReclaimer();
+    return *reclaimer;
+}
+
+inline void RBTreeReclaimer::retire(void* root, Destroy destroy) {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(Task{root, destroy});
+
+    if (!running) {
+        std::thread(&RBTreeReclaimer::run, this).detach();
+        running = true;
+    }
+
+    wakeup.notify_one();
+}
+
+inline void RBTreeReclaimer::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return tasks.empty() && busy == 0; });
+}
+
+inline void RBTreeReclaimer::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        wakeup.wait(lock, [this] { return !tasks.empty(); });
+
+        Task task = tasks.front();
+        tasks.pop_front();
+        busy++;
+
+        lock.unlock();
+        task.destroy(task.root);
+        lock.lock();
+
+        busy--;
+
+        if (tasks.empty() && busy == 0) {
+            idle.notify_all();
+        }
+    }
+}
+
+//In-order neighbours of a node, only threaded trees store them. Unlike the
+//classic threading, which tags the empty child slots, this is an explicit
+//doubly linked list through the nodes: two more pointers per node, but every
+//step is a single hop and rotations never touch the list.
+template<bool Threaded, typename Node>
+struct RBTreeNodeList {
+    inline Node* getPrev() const { return NULL; }
+    inline Node* getNext() const { return NULL; }
+    inline void setPrev(Node*) {}
+    inline void setNext(Node*) {}
+};
+
+template<typename Node>
+struct RBTreeNodeList<true, Node> {
+    Node* prev = NULL;
+    Node* next = NULL;
+
+    inline Node* getPrev() const { return prev; }
+    inline Node* getNext() const { return next; }
+    inline void setPrev(Node* prev) { this->prev = prev; }
+    inline void setNext(Node* next) { this->next = next; }
+};
+
+//Augmentation policy of a tree. Every node stores a value of its subtree:
+//combine(combine(left, of(key, count)), right), where a missing child is
+//skipped. combine has to be associative. The value is maintained through
+//rotations, fixups and the bulk operations. This policy stores nothing.
+struct RBTreeNoAugment {
+    struct value_type {
+        inline bool operator== (const value_type&) const { return true; }
+    };
+
+    template<typename T>
+    static inline value_type of(const T&, unsigned int) { return value_type(); }
+    static inline value_type combine(const value_type&, const value_type&) { return value_type(); }
+};
+
+//Augmented value of the subtree of a node, only augmented trees store it
+template<typename Augment>
+struct RBTreeNodeAugment {
+    typename Augment::value_type augmentation;
+
+    inline const typename Augment::value_type& getAugment() const { return augmentation; }
+    inline void setAugment(const typename Augment::value_type& augmentation) { this->augmentation = augmentation; }
+};
+
+template<>
+struct RBTreeNodeAugment<RBTreeNoAugment> {
+    inline RBTreeNoAugment::value_type getAugment() const { return RBTreeNoAugment::value_type(); }
+    inline void setAugment(const RBTreeNoAugment::value_type&) {}
+};
+
+//Order preserving mapping of integer keys to unsigned 64 bit values, which
+//selects the bucket of a key in the jump table. Other keys have no mapping.
+template<typename T, bool Integral = std::is_integral<T>::value>
+struct RBTreeJumpKey {
+    static const bool usable = false;
+    static inline uint64_t ordinal(const T&) { return 0; }
+};
+
 template<typename T>
+struct RBTreeJumpKey<T, true> {
+    static const bool usable = true;
+
+    //Flipping the sign bit moves negative keys before the positive ones
+    static inline uint64_t ordinal(T key) {
+        return std::is_signed<T>::value ? ((uint64_t)(int64_t)key ^ ((uint64_t)1 << 63)) : (uint64_t)key;
+    }
+};
+
+template<typename T, typename Compare = std::less<T>, bool Multi = false, bool Threaded = false,
+         typename Augment = RBTreeNoAugment>
 class RBTree {
+public:
+    class iterator;
+
 private:
     //Tree node sub class
-    class RBTreeNode {
+    class RBTreeNode : public RBTreeNodeCount<Multi>, public RBTreeNodeList<Threaded, RBTreeNode>,
+                       public RBTreeNodeAugment<Augment> {
     private:
-        enum Color {
+        enum Color : unsigned char {
             RED = 0,
             BLACK = 1,
             DOUBLE_BLACK = 2,
@@ -30,44 +216,449 @@ private:
         T key;
         Color color;
 
+        //Node is stored in a NodeArena block instead of a single allocation
+        bool pooled;
+
+        //Node is the start of a jump table bucket. Only a rotation that moves
+        //the node down can take keys of the bucket out of its subtree, so the
+        //rotation revokes it.
+        bool jumpTarget;
+
         RBTreeNode* parent;
         RBTreeNode* left;
         RBTreeNode* right;
-        RBTree<T>* tree;
 
     public:
-        RBTreeNode(const T key, RBTree<T>* tree);
-        RBTreeNode(const T key, RBTreeNode* parent, RBTree<T>* tree, Color color);
-        virtual ~RBTreeNode();
-
-        friend class RBTree<T>;
+        explicit RBTreeNode(const T& key);
+        explicit RBTreeNode(T&& key);
+        RBTreeNode(const T& key, RBTreeNode* parent, Color color);
+        //The childs are released by the tree without recursion
+        virtual ~RBTreeNode() {}
+
+        //Single nodes are taken from the node cache when it is enabled
+        static void* operator new(size_t size);
+        static void operator delete(void* memory);
+        static inline void* operator new(size_t, void* place) { return place; }
+        static inline void operator delete(void*, void*) {}
+
+        friend class RBTree<T, Compare, Multi, Threaded, Augment>;
         friend class iterator;
 
         #ifdef DEBUG
-        bool invariant();
+        bool invariant(const Compare& comp);
         int invariantBlackNodes();
         void toString(ostream& buffer, const string& prefix, bool lastNode);
         void dumpNode(ofstream& graphFile);
         #endif
 
         inline bool isBlack() const { return (this->color == BLACK); }
-        inline void adjustInsert(RBTreeNode* insertNode);
-        inline void adjustRemove();
-        inline void leftRotate();
-        inline void rightRotate();
-
-        RBTreeNode* lookup(const T key);
-        bool insert(const T key);
-        void remove();
+        inline void adjustInsert(RBTreeNode* insertNode, RBTreeNode*& treeRoot);
+        inline void adjustRemove(RBTreeNode*& treeRoot);
+        inline void leftRotate(RBTreeNode*& treeRoot);
+        inline void rightRotate(RBTreeNode*& treeRoot);
+
+        template<typename K>
+        RBTreeNode* lookup(const K& key, const Compare& comp);
+        bool insert(const T& key, const Compare& comp, RBTreeNode*& treeRoot);
+        inline void swapPosition(RBTreeNode* successor, RBTreeNode*& treeRoot);
+        void unlink(RBTreeNode*& treeRoot);
+        void remove(RBTreeNode*& treeRoot);
     } *root;
 
+    Compare comp;
+
+    //Detached nodes are freed by the reclaimer thread
+    bool deferred;
+
+    //Contiguous storage for many nodes (e.g. a cloned tree). The nodes are
+    //placed in aligned blocks, so every node finds the live counter of its
+    //block by masking its address. A block is freed with its last node.
+    //A few nodes are allocated on their own, so a small tree does not pin a
+    //block. A block holds the expected number of nodes, or without a known
+    //count as many nodes as were created before, up to BLOCK_SIZE.
+    class NodeArena {
+        private:
+            static const size_t BLOCK_SIZE = 64 * 1024;
+
+            //Nodes of an arena that are allocated on their own
+            static const size_t SINGLE_NODES = 32;
+
+            struct Block {
+                std::atomic<size_t> live;
+            };
+
+            static const size_t HEADER_SIZE = 
+                (sizeof(Block) + alignof(RBTreeNode) - 1) / alignof(RBTreeNode) * alignof(RBTreeNode);
+
+            Block* block;
+            char* next;
+            char* end;
+            size_t created;
+
+            //Nodes that are still expected, 0 for an unknown count
+            size_t expected;
+
+            static void releaseBlock(Block* block);
+
+        public:
+            NodeArena() : block(NULL), next(NULL), end(NULL), created(0), expected(0) {}
+            explicit NodeArena(size_t expected) : block(NULL), next(NULL), end(NULL), created(0), expected(expected) {}
+            NodeArena(const NodeArena&) = delete;
+            ~NodeArena() { releaseBlock(block); }
+
+            NodeArena& operator= (const NodeArena&) = delete;
+
+            //Large nodes are allocated on their own
+            static const bool usable = (HEADER_SIZE + 16 * sizeof(RBTreeNode) <= BLOCK_SIZE);
+
+            RBTreeNode* create(const RBTreeNode* source, RBTreeNode* parent);
+            template<typename K>
+            RBTreeNode* create(K&& key, unsigned int count);
+            static void release(RBTreeNode* node);
+    };
+
+    //Recycles the memory of single nodes for all trees of this type. Every
+    //thread keeps a free list of its own and exchanges batches of nodes with
+    //a shared depot, so the allocator is only called when the depot is empty
+    //and nodes freed by one thread are reused by the others.
+    class NodeCache {
+        private:
+            static const size_t BATCH_SIZE = 32;
+
+            //Free list of a thread, trivial so that it outlives all other
+            //thread local objects that may still release nodes
+            struct Local {
+                void* head;
+                size_t count;
+                bool registered;
+                bool closed;
+            };
+
+            //Hands the free list of a thread to the depot when it ends
+            struct LocalFlush {
+                ~LocalFlush();
+            };
+
+            //Batches of BATCH_SIZE linked nodes
+            struct Depot {
+                std::mutex lock;
+                std::vector<void*> batches;
+            };
+
+            static thread_local Local local;
+            static std::atomic<size_t> capacity;
+
+            static Depot& depot();
+            static inline void*& nextFree(void* memory) { return *static_cast<void**>(memory); }
+            static void registerFlush(Local& cache);
+            static void transfer(Local& cache);
+            static void freeList(void* head);
+
+        public:
+            static void* allocate(size_t size);
+            static void release(void* memory);
+            static void resize(size_t batches);
+            static inline size_t batches() { return capacity.load(std::memory_order_relaxed); }
+    };
+
+    //State of an incremental relayout. The next key is kept instead of a
+    //node, so the tree may be changed between the steps.
+    struct Relayout {
+        NodeArena arena;
+        T next;
+
+        explicit Relayout(const T& next) : next(next) {}
+    };
+
+    Relayout* relayout;
+
+    RBTreeNode* relocate(RBTreeNode* node, NodeArena& arena);
+
+    //Jump table for integer keys in ascending order. The key range is split
+    //into buckets of consecutive keys, a bucket points to the first node on
+    //the search path of all of its keys. A descent starts at that node instead
+    //of the root, which skips the top levels of the tree.
+    static const bool JUMPABLE = RBTreeJumpKey<T>::usable &&
+        (std::is_same<Compare, std::less<T>>::value || std::is_same<Compare, std::less<>>::value);
+
+    struct JumpTable {
+        std::vector<RBTreeNode*> buckets;
+        uint64_t base;
+        unsigned int bits;
+        unsigned int shift;
+
+        //Descents of keys outside of the buckets since the range was chosen
+        size_t misses;
+
+        //The range is chosen again before the next descent
+        bool stale;
+
+        explicit JumpTable(unsigned int bits) : base(0), bits(bits), shift(0), misses(0), stale(true) {}
+    };
+
+    JumpTable* jumps;
+
+    template<typename K>
+    RBTreeNode* jumpStart(const K& key);
+    inline bool jumpBucket(uint64_t ordinal, size_t& bucket) const;
+    RBTreeNode* bucketRoot(size_t bucket, RBTreeNode*& last);
+    void rebuildJumps();
+    inline void dropJump(RBTreeNode* node);
+
+    //Bulk operations rebuild the tree, the table is rebuilt lazily
+    inline void invalidateJumps() { if (jumps != NULL) jumps->stale = true; }
+
+    static void release(RBTreeNode* node);
+    static RBTreeNode* clone(const RBTreeNode* source);
+
+    //Upper bound for the height of a red-black tree with 64 bit sizes
+    static const int MAX_HEIGHT = 128;
+
+    static RBTreeNode* minimum(RBTreeNode* node);
+    static RBTreeNode* successor(RBTreeNode* node);
+    static RBTreeNode* predecessor(RBTreeNode* node);
+    static RBTreeNode* treeSuccessor(RBTreeNode* node);
+    static RBTreeNode* treePredecessor(RBTreeNode* node);
+
+    //Maintenance of the augmented values, nothing is done without augmentation
+    static const bool AUGMENTED = !std::is_same<Augment, RBTreeNoAugment>::value;
+
+    static inline typename Augment::value_type computeAugment(const RBTreeNode* node);
+    static inline void augment(RBTreeNode* node);
+    static void augmentPath(RBTreeNode* node);
+    static void augmentAll(RBTreeNode* treeRoot);
+
+    //Maintenance of the in-order links of threaded trees
+    static inline void linkBetween(RBTreeNode* node, RBTreeNode* prev, RBTreeNode* next);
+    static inline void unlinkInOrder(RBTreeNode* node);
+    static void linkInOrder(RBTreeNode** nodes, size_t count);
+    static void linkInOrder(RBTreeNode* treeRoot);
+    static int blackHeight(RBTreeNode* node);
+    static RBTreeNode* join(RBTreeNode* left, RBTreeNode* middle, RBTreeNode* right);
+    static RBTreeNode* join(RBTreeNode* left, RBTreeNode* right);
+    struct BuildRange {
+        size_t from;
+        size_t to;
+        RBTreeNode* parent;
+        bool leftChild;
+        int depth;
+    };
+
+    static int deepestLevel(size_t count);
+    static RBTreeNode* build(RBTreeNode** nodes, size_t count);
+    static RBTreeNode* buildRange(RBTreeNode** nodes, BuildRange range, int redDepth,
+                                  int cutDepth, std::vector<BuildRange>* cut);
+    static size_t destroy(RBTreeNode* node);
+    static size_t destroyDetached(void* node);
+
+    template<typename K>
+    void split(RBTreeNode* node, const K& key, RBTreeNode*& left, RBTreeNode*& right);
+    size_t eraseNodes(const T& from, const T* to);
+    static void flatten(RBTreeNode* treeRoot, std::vector<RBTreeNode*>& nodes);
+
+    bool insertNode(RBTreeNode* node);
+
+    //In-order piece of the tree for parallel traversals, either a whole
+    //subtree or a single node above the subtrees
+    struct Segment {
+        RBTreeNode* node;
+        bool whole;
+    };
+
+    //Subtrees per thread, so that threads with small subtrees take more work
+    static const unsigned int SEGMENTS_PER_THREAD = 4;
+
+    std::vector<Segment> segments(size_t subtrees);
+    template<typename Function>
+    static void visit(const Segment& segment, Function& fn);
+    static unsigned int workerCount(unsigned int threads);
+    template<typename Function>
+    static void runParallel(size_t tasks, unsigned int threads, Function fn);
+    void parallelSort(std::vector<T>& keys, unsigned int threads);
+
+    //Small trivially copyable keys (e.g. int) are cheap to compare, so their
+    //descent selects the child from the comparison result without a branch
+    static const bool BRANCHLESS = std::is_trivially_copyable<T>::value && sizeof(T) <= 8;
+
+    //Selects one of two nodes with a mask, compilers turn a plain conditional
+    //back into a branch for the descent
+    static inline RBTreeNode* select(bool second, RBTreeNode* first, RBTreeNode* other) {
+        uintptr_t mask = (uintptr_t)0 - (uintptr_t)second;
+        return reinterpret_cast<RBTreeNode*>((reinterpret_cast<uintptr_t>(first) & ~mask) |
+                                             (reinterpret_cast<uintptr_t>(other) & mask));
+    }
+
+    template<typename K>
+    RBTreeNode* lookup(const K& key);
+    template<typename K>
+    RBTreeNode* lowerBound(const K& key, RBTreeNode* subtree);
+    template<typename K>
+    bool removeKey(const K& key);
+
 public:
+    //Owning handle of a detached node, moving it between trees of the same
+    //type does not allocate or copy the key
+    class node_type {
+        private:
+            RBTreeNode* node;
+            friend class RBTree<T, Compare, Multi, Threaded, Augment>;
+
+            explicit node_type(RBTreeNode* _node) : node(_node) {}
+
+        public:
+            node_type() : node(NULL) {}
+            node_type(node_type&& other) : node(other.node) { other.node = NULL; }
+            node_type(const node_type&) = delete;
+            ~node_type() { if (node != NULL) release(node); }
+
+            node_type& operator= (const node_type&) = delete;
+            inline node_type& operator= (node_type&& other) {
+                if (this != &other) {
+                    if (node != NULL) release(node);
+                    node = other.node;
+                    other.node = NULL;
+                }
+                return *this;
+            }
+
+            inline bool empty() const { return node == NULL; }
+            inline explicit operator bool() const { return node != NULL; }
+
+            //The key may be changed before the node is inserted again
+            inline T& value() const { return node->key; }
+            inline unsigned int count() const { return node->getCount(); }
+    };
+
+    typedef T value_type;
+    typedef Compare key_compare;
+    typedef typename Augment::value_type augment_type;
+
+    //Read-only view of a node for searches that use the augmented values,
+    //e.g. to skip subtrees. A view is invalidated by changes of the tree.
+    class node_view {
+        private:
+            const RBTreeNode* node;
+            friend class RBTree<T, Compare, Multi, Threaded, Augment>;
+
+            explicit node_view(const RBTreeNode* _node) : node(_node) {}
+
+        public:
+            node_view() : node(NULL) {}
+
+            inline explicit operator bool() const { return node != NULL; }
+            inline const T& key() const { return node->key; }
+            inline unsigned int count() const { return node->getCount(); }
+            inline augment_type augment() const { return node->getAugment(); }
+            inline node_view left() const { return node_view(node->left); }
+            inline node_view right() const { return node_view(node->right); }
+    };
+
+    inline node_view root_view() const { return node_view(root); }
+
     RBTree();
+    explicit RBTree(const Compare& comp);
+    RBTree(const RBTree<T, Compare, Multi, Threaded, Augment>& other);
+    RBTree(RBTree<T, Compare, Multi, Threaded, Augment>&& other);
     virtual ~RBTree();
 
-    bool contains(const T key);
-    bool insert(const T key);
-    bool remove(const T key);
+    RBTree<T, Compare, Multi, Threaded, Augment>& operator= (const RBTree<T, Compare, Multi, Threaded, Augment>& other);
+    RBTree<T, Compare, Multi, Threaded, Augment>& operator= (RBTree<T, Compare, Multi, Threaded, Augment>&& other);
+    void swap(RBTree<T, Compare, Multi, Threaded, Augment>& other);
+
+    //Removes all keys without recursion, in deferred destruction mode the
+    //nodes are handed to the reclaimer thread and clear returns in O(1)
+    void clear();
+    void setDeferredDestruction(bool deferred);
+    inline bool deferredDestruction() const { return deferred; }
+    inline bool empty() const { return root == NULL; }
+    inline Compare key_comp() const { return comp; }
+
+    //Moves all nodes into new contiguous blocks without changing the shape
+    //or the colors. A block holds the top levels of a subtree (about a page)
+    //and the blocks are laid out depth-first, so a lookup touches few pages.
+    void defragment();
+
+    //Incremental relayout that moves at most budget nodes per call in
+    //key order. Returns true when all nodes have been moved once.
+    bool defragment_step(size_t budget);
+
+    //Jump table with 2^bits buckets for integer keys in ascending order, 0
+    //disables it. The buckets are spread over the keys of the tree when it is
+    //first used, a tree with about 2^(bits + 4) keys skips about bits levels.
+    void setJumpTable(unsigned int bits);
+    inline unsigned int jumpTableBits() const { return (jumps == NULL) ? 0 : jumps->bits; }
+
+    //Node cache shared by all trees of this type, the depot keeps up to
+    //batches * 32 free nodes and every thread up to 64. 0 disables the cache
+    //and frees the kept nodes of the depot and of the calling thread.
+    static inline void setNodeCache(size_t batches) { NodeCache::resize(batches); }
+    static inline size_t nodeCacheBatches() { return NodeCache::batches(); }
+
+    //Memory of a single node in bytes
+    static inline size_t nodeSize() { return sizeof(RBTreeNode); }
+
+    bool contains(const T& key);
+    bool insert(const T& key);
+    bool remove(const T& key);
+    unsigned int count(const T& key);
+    iterator find(const T& key);
+    iterator lower_bound(const T& key);
+
+    //Node handles, a multiset node is extracted with all of its copies
+    node_type extract(iterator position);
+    node_type extract(const T& key);
+    bool insert(node_type&& handle);
+
+    //Inserts a batch of keys. Small batches are inserted one by one, large
+    //ones are merged with the nodes of the tree and rebuilt in O(n + m).
+    template<typename InputIterator>
+    void insert(InputIterator first, InputIterator last);
+    void merge(RBTree<T, Compare, Multi, Threaded, Augment>& other);
+
+    //Range erase detaches [first, last) via split and join in O(log n + k)
+    iterator erase(iterator first, iterator last);
+    size_t erase_range(const T& from, const T& to);
+
+    //Removes all matching keys in one pass and rebuilds the rest in O(n)
+    template<typename Predicate>
+    size_t erase_if(Predicate pred);
+
+    //Parallel traversals over disjoint subtrees near the root, the tree must
+    //not be modified until they return. A thread count of 0 uses all hardware
+    //threads. fn is called concurrently and in no particular order.
+    template<typename Function>
+    void parallel_for_each(Function fn, unsigned int threads = 0);
+
+    //Every subtree is reduced from init, so init has to be the identity of
+    //combine. The partial results are combined in key order.
+    template<typename Value, typename Reduce, typename Combine>
+    Value parallel_reduce(Value init, Reduce reduce, Combine combine, unsigned int threads = 0);
+
+    //Replaces the content by the keys of an unsorted range. The keys are sorted
+    //in parallel, then disjoint slices are deduplicated into per-thread arenas
+    //and linked concurrently below the top levels of a balanced tree.
+    template<typename InputIterator>
+    void assign_parallel(InputIterator first, InputIterator last, unsigned int threads = 0);
+
+    //Heterogeneous lookups are only enabled for transparent comparators
+    //(e.g. std::less<>) so that no temporary key has to be constructed
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    bool contains(const K& key);
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    bool remove(const K& key);
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    unsigned int count(const K& key);
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    node_type extract(const K& key);
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator find(const K& key);
+
+    template<typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator lower_bound(const K& key);
 
     #ifdef DEBUG
     bool invariant();
@@ -78,13 +669,17 @@ public:
     class iterator {
         private:
             RBTreeNode* node = nullptr;
+
+            //Position within the multiplicity of a multiset node
+            unsigned int repeat = 0;
             
         public:
             typedef T value_type;
             typedef const T& reference;
             typedef const T* pointer;
-            typedef std::input_iterator_tag iterator_category;
-            friend class RBTree<T>;
+            typedef std::ptrdiff_t difference_type;
+            typedef std::forward_iterator_tag iterator_category;
+            friend class RBTree<T, Compare, Multi, Threaded, Augment>;
             
             explicit iterator(RBTreeNode* _node) : node(_node) {}
             //implicit copy constructor
@@ -95,8 +690,17 @@ public:
                 ++(*this);
                 return it;
             }
+
+            //Decrementing the end iterator is not supported, the iterator
+            //does not know its tree
+            iterator& operator-- ();
+            inline iterator operator-- (int) {
+                iterator it = *this;
+                --(*this);
+                return it;
+            }
             
-            inline bool operator== (const iterator& other) { return node == other.node; }
+            inline bool operator== (const iterator& other) { return node == other.node && repeat == other.repeat; }
             inline bool operator!= (const iterator& other) { return !(*this == other); }
             
             inline reference operator* () { return node->key; }
@@ -108,88 +712,105 @@ public:
 };
 
 //Tree nodes
-template <typename T>
-RBTree<T>::RBTreeNode::RBTreeNode(const T key, RBTree<T>* tree) {
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode::RBTreeNode(const T& key)
+    : key(key) {
     this->left = NULL;
     this->right = NULL;
     this->parent = NULL;
-    this->key = key;
-    this->tree = tree;
     this->color = BLACK;
+    this->pooled = false;
+    this->jumpTarget = false;
 }
 
-template <typename T>
-RBTree<T>::RBTreeNode::RBTreeNode(const T key, RBTreeNode* parent, RBTree<T>* tree, Color color) {
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode::RBTreeNode(T&& key)
+    : key(std::move(key)) {
     this->left = NULL;
     this->right = NULL;
-    this->parent = parent;
-    this->key = key;
-    this->tree = tree;
-    this->color = color;
+    this->parent = NULL;
+    this->color = BLACK;
+    this->pooled = false;
+    this->jumpTarget = false;
 }
 
-template <typename T>
-RBTree<T>::RBTreeNode::~RBTreeNode() {
-    if (this->left != NULL) {
-        delete this->left;
-    }
-
-    if (this->right != NULL) {
-        delete this->right;
-    }
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode::RBTreeNode(const T& key, RBTreeNode* parent, Color color)
+    : key(key) {
+    this->left = NULL;
+    this->right = NULL;
+    this->parent = parent;
+    this->color = color;
+    this->pooled = false;
+    this->jumpTarget = false;
 }
 
-template <typename T>
-typename RBTree<T>::RBTreeNode* 
-         RBTree<T>::RBTreeNode::lookup(const T key) {
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename K>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode* 
+         RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode::lookup(const K& key, const Compare& comp) {
 
     RBTreeNode* node = this;
 
-    while (node != NULL && node->key != key) {
-        node = node->key < key 
-                ? node->right
-                : node->left;
+    while (node != NULL) {
+        if (comp(key, node->key)) {
+            node = node->left;
+        } else if (comp(node->key, key)) {
+            node = node->right;
+        } else {
+            break;
+        }
     }
 
     return node;
 }
 
-template <typename T>
-bool RBTree<T>::RBTreeNode::insert(const T key) {
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+bool RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode::insert(const T& key, const Compare& comp, RBTreeNode*& treeRoot) {
     //Find the insertion position
     RBTreeNode* node = this;
     bool nodeInserted = false;
 
     while (!nodeInserted) {
-        if (node->key == key) return false;
-
-        if (node->key < key) {
+        if (comp(node->key, key)) {
             if (node->right == NULL) {
-                node->right = new RBTreeNode(key, node, tree, RED);
-                adjustInsert(node->right);
+                node->right = new RBTreeNode(key, node, RED);
+                linkBetween(node->right, node, node->getNext());
+                augmentPath(node->right);
+                adjustInsert(node->right, treeRoot);
                 nodeInserted = true;
 
             } else {
                 node = node->right;
             }
 
-        } else {
+        } else if (comp(key, node->key)) {
             if (node->left == NULL) {
-                node->left = new RBTreeNode(key, node, tree, RED);
-                adjustInsert(node->left);
+                node->left = new RBTreeNode(key, node, RED);
+                linkBetween(node->left, node->getPrev(), node);
+                augmentPath(node->left);
+                adjustInsert(node->left, treeRoot);
                 nodeInserted = true;
 
             } else {
                 node = node->left;
             }
+
+        } else {
+            //Duplicates only increase the multiplicity of a multiset node
+            if (!Multi) return false;
+
+            node->setCount(node->getCount() + 1);
+            augmentPath(node);
+            return true;
         }
     }
 
     return true;
 }
 
-template <typename T>
-void RBTree<T>::RBTreeNode::adjustInsert(RBTreeNode* insertNode) {
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode::adjustInsert(RBTreeNode* insertNode, RBTreeNode*& treeRoot) {
     //Adjust the tree after an insertion
     RBTreeNode* node = insertNode;
 
@@ -234,11 +855,11 @@ void RBTree<T>::RBTreeNode::adjustInsert(RBTreeNode* insertNode) {
                 //rotate the parent into the grandparent position
 
                 if (grand->left != NULL && node == grand->left->right) {
-                    parent->leftRotate();
+                    parent->leftRotate(treeRoot);
                     node = node->left;
 
                 } else if (grand->right != NULL && node == grand->right->left) {
-                    parent->rightRotate();
+                    parent->rightRotate(treeRoot);
                     node = node->right;
                 }
                 
@@ -248,9 +869,9 @@ void RBTree<T>::RBTreeNode::adjustInsert(RBTreeNode* insertNode) {
 
                 //The node will not be a subtree of the grandparent
                 if (node == parent->left) {
-                    grand->rightRotate();
+                    grand->rightRotate(treeRoot);
                 } else {
-                    grand->leftRotate();
+                    grand->leftRotate(treeRoot);
                 }
 
                 parent->color = BLACK;
@@ -260,8 +881,8 @@ void RBTree<T>::RBTreeNode::adjustInsert(RBTreeNode* insertNode) {
     }
 }
 
-template <typename T>
-void RBTree<T>::RBTreeNode::leftRotate() {
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode::leftRotate(RBTreeNode*& treeRoot) {
     #ifdef DEBUG
     //the right node will be the new parent
     assert (this->right != NULL);
@@ -289,15 +910,20 @@ void RBTree<T>::RBTreeNode::leftRotate() {
     }
     
     this->parent = root;
+    this->jumpTarget = false;
+
+    //the lower node first, it is a child of the new root
+    augment(this);
+    augment(root);
 
     //set the new root of the tree
     if (root->parent == NULL) {
-        tree->root = root;
+        treeRoot = root;
     }
 }
 
-template <typename T>
-void RBTree<T>::RBTreeNode::rightRotate() {
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode::rightRotate(RBTreeNode*& treeRoot) {
     #ifdef DEBUG
     //the left node will be the new parent
     assert (this->left != NULL);
@@ -325,29 +951,86 @@ void RBTree<T>::RBTreeNode::rightRotate() {
     }
     
     this->parent = root;
+    this->jumpTarget = false;
+
+    //the lower node first, it is a child of the new root
+    augment(this);
+    augment(root);
 
     //set the new root of the tree
     if (root->parent == NULL) {
-        tree->root = root;
+        treeRoot = root;
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode::swapPosition(RBTreeNode* successor, RBTreeNode*& treeRoot) {
+    //Exchange the tree position of this node with its successor, which is the
+    //minimum of the right subtree. The keys stay in their nodes.
+    RBTreeNode* successorParent = successor->parent;
+    RBTreeNode* successorRight = successor->right;
+
+    //The successor takes the position of this node
+    successor->parent = this->parent;
+
+    if (this->parent == NULL) {
+        treeRoot = successor;
+    } else if (this->parent->left == this) {
+        this->parent->left = successor;
+    } else {
+        this->parent->right = successor;
+    }
+
+    successor->left = this->left;
+    this->left->parent = successor;
+
+    if (successorParent == this) {
+        //The successor was the right child of this node
+        successor->right = this;
+        this->parent = successor;
+
+    } else {
+        successor->right = this->right;
+        this->right->parent = successor;
+        successorParent->left = this;
+        this->parent = successorParent;
+    }
+
+    //This node takes the old position of the successor
+    this->left = NULL;
+    this->right = successorRight;
+
+    if (successorRight != NULL) {
+        successorRight->parent = this;
     }
+
+    //The colors belong to the positions
+    Color color = this->color;
+    this->color = successor->color;
+    successor->color = color;
 }
 
-template <typename T>
-void RBTree<T>::RBTreeNode::remove() {
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode::unlink(RBTreeNode*& treeRoot) {
+    //Detach this node from the tree without deleting it
     RBTreeNode* node = this;
+    unlinkInOrder(node);
 
     if (this->left != NULL && this->right != NULL) {
         //For the 2 child case we will convert the problem into 1 or 0 childs
         //Therefore find the minimum element in the right subtree
+        RBTreeNode* successor = this->right;
 
-        node = this->right;
-
-        while (node->left != NULL) {
-            node = node->left;
+        while (successor->left != NULL) {
+            //The successor moves above the nodes on the way, which lose the
+            //keys between this node and the successor like after a rotation
+            successor->jumpTarget = false;
+            successor = successor->left;
         }
 
-        //Swap the node values and remove the minimum node
-        this->key = node->key;
+        //Move the minimum node into this position instead of copying its key,
+        //so that other nodes (and their keys) are never moved between nodes
+        swapPosition(successor, treeRoot);
     }
 
     //Now we have 1 or 0 childs
@@ -355,9 +1038,25 @@ void RBTree<T>::RBTreeNode::remove() {
                         ? node->right 
                         : node->left;
 
+    //Red nodes can be deleted without any tree repairing
+    if (node->color == BLACK) {
+        
+        //When the child is red change the color to black
+        if (child != NULL && child->color == RED) {
+            child->color = BLACK;
+            
+        } else {
+            //Node and the child are both black (that means the child is null)
+            //The node is a black leaf and will be the double black leaf itself,
+            //so no pseudo node (and no key for it) is needed for the repairing
+            node->color = DOUBLE_BLACK;
+            node->adjustRemove(treeRoot);
+        }
+    }
+
     //Detach the node from the tree
     if (node->parent == NULL) {
-        node->tree->root = child;
+        treeRoot = child;
 
     } else if (node->parent->left == node) {
         node->parent->left = child;
@@ -371,54 +1070,23 @@ void RBTree<T>::RBTreeNode::remove() {
         child->parent = node->parent;
     }
 
-    //Red nodes can be deleted without any tree repairing
-    if (node->color == BLACK) {
-        
-        //When the child is red change the color to black
-        if (child != NULL && child->color == RED) {
-            child->color = BLACK;
-            
-        } else {
-            //Node and the child are both black (that means the child is null)
-            //Create a pseudo double black leaf
-            child = new RBTreeNode((T)0, node->parent, node->tree, DOUBLE_BLACK);
-
-            //Attach the double black leaf node
-            if (node->parent == NULL) {
-                node->tree->root = child;
+    //All changed nodes are ancestors of the removed position, also those
+    //that were rotated while the node served as double black leaf
+    augmentPath(node->parent);
 
-            } else if (node->parent->left == NULL) {
-                node->parent->left = child;
-
-            } else {
-                node->parent->right = child;
-            }
-
-            child->adjustRemove();
-
-            //Detach the pseudo node from the tree
-            if (child->parent == NULL) {
-                child->tree->root = NULL;
-
-            } else if (child->parent->left == child) {
-                child->parent->left = NULL;
-
-            } else {
-                child->parent->right = NULL;
-            }
-
-            delete child;
-        }
-    }
-
-    //Prevent the destructor from deleting nodes
+    node->parent = NULL;
     node->left = NULL;
     node->right = NULL;
-    delete node;
 }
 
-template <typename T>
-void RBTree<T>::RBTreeNode::adjustRemove() {
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode::remove(RBTreeNode*& treeRoot) {
+    unlink(treeRoot);
+    release(this);
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode::adjustRemove(RBTreeNode*& treeRoot) {
     //Adjust the tree when a node was colored double black
     #ifdef DEBUG
     assert (this->color == DOUBLE_BLACK);
@@ -444,11 +1112,11 @@ void RBTree<T>::RBTreeNode::adjustRemove() {
             parent->color = RED;
 
             if (node == parent->left) {
-                parent->leftRotate();
+                parent->leftRotate(treeRoot);
                 sibling = parent->right;
 
             } else {
-                parent->rightRotate();
+                parent->rightRotate(treeRoot);
                 sibling = parent->left;
             }
         }
@@ -479,7 +1147,7 @@ void RBTree<T>::RBTreeNode::adjustRemove() {
 
                 sibling->color = RED;
                 sibling->left->color = BLACK;
-                sibling->rightRotate();
+                sibling->rightRotate(treeRoot);
                 sibling = sibling->parent;
 
         //Black sibling with the siblings right child red
@@ -488,7 +1156,7 @@ void RBTree<T>::RBTreeNode::adjustRemove() {
 
                 sibling->color = RED;
                 sibling->right->color = BLACK;
-                sibling->leftRotate();
+                sibling->leftRotate(treeRoot);
                 sibling = sibling->parent;
         }
 
@@ -496,11 +1164,11 @@ void RBTree<T>::RBTreeNode::adjustRemove() {
         parent->color = BLACK;
 
         if (node == parent->left) {
-            parent->leftRotate();
+            parent->leftRotate(treeRoot);
             sibling->right->color = BLACK;
 
         } else {
-            parent->rightRotate();
+            parent->rightRotate(treeRoot);
             sibling->left->color = BLACK;
         }
         return;
@@ -508,8 +1176,8 @@ void RBTree<T>::RBTreeNode::adjustRemove() {
 }
 
 #ifdef DEBUG
-template <typename T>
-bool RBTree<T>::RBTreeNode::invariant() {
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+bool RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode::invariant(const Compare& comp) {
 
     //If a node is red then both children are black
     bool invColor = (color == BLACK) || (
@@ -518,19 +1186,26 @@ bool RBTree<T>::RBTreeNode::invariant() {
     );
 
     //Left nodes have a lower order and right nodes a higher order
-    bool invOrder = (left == NULL  || left->key  < this->key) && 
-                    (right == NULL || right->key > this->key);
+    bool invOrder = (left == NULL  || comp(left->key, this->key)) && 
+                    (right == NULL || comp(this->key, right->key));
 
     //Every path to a leaf node contains the same number of black nodes
     bool blackNodeCount = invariantBlackNodes() > -1;
 
-    return invColor && invOrder && blackNodeCount && 
-           (left == NULL || left->invariant()) && 
-           (right == NULL || right->invariant());
+    //The children link back to their parent
+    bool invParent = (left == NULL  || left->parent == this) && 
+                     (right == NULL || right->parent == this);
+
+    //The augmented value matches the subtree
+    bool invAugment = !AUGMENTED || this->getAugment() == computeAugment(this);
+
+    return invColor && invOrder && blackNodeCount && invParent && invAugment && 
+           (left == NULL || left->invariant(comp)) && 
+           (right == NULL || right->invariant(comp));
 }
 
-template <typename T>
-int RBTree<T>::RBTreeNode::invariantBlackNodes() {
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+int RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode::invariantBlackNodes() {
     //Empty Nodes will be treated as black nodes
     int leftCount = (this->left == NULL)
                     ? 1
@@ -546,10 +1221,16 @@ int RBTree<T>::RBTreeNode::invariantBlackNodes() {
            : -1;
 }
 
-template <typename T>
-void RBTree<T>::RBTreeNode::toString(ostream& buffer, const string& prefix, bool lastNode) {
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode::toString(ostream& buffer, const string& prefix, bool lastNode) {
     //print the current element and the children
-    buffer << prefix << (lastNode ? "└── " : "├── ") << key << (color == RED ? " (R)" : " (B)") << endl;
+    buffer << prefix << (lastNode ? "└── " : "├── ") << key << (color == RED ? " (R)" : " (B)");
+
+    if (this->getCount() > 1) {
+        buffer << " x" << this->getCount();
+    }
+
+    buffer << endl;
 
     if (left != NULL) {
         left->toString(buffer, prefix + (lastNode ? "    " : "│   "), right == NULL);
@@ -560,8 +1241,8 @@ void RBTree<T>::RBTreeNode::toString(ostream& buffer, const string& prefix, bool
     }
 }
 
-template <typename T>
-void RBTree<T>::RBTreeNode::dumpNode(ofstream& graphFile) {
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode::dumpNode(ofstream& graphFile) {
     graphFile << "\"" << key << "\" " << "[shape=circle, style=filled, fillcolor=";
 
     switch (color) {
@@ -596,125 +1277,1874 @@ void RBTree<T>::RBTreeNode::dumpNode(ofstream& graphFile) {
 #endif
 
 
-//tree
-template <typename T>
-RBTree<T>::RBTree() {   
-    this->root = NULL;
+//Node cache
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+thread_local typename RBTree<T, Compare, Multi, Threaded, Augment>::NodeCache::Local
+         RBTree<T, Compare, Multi, Threaded, Augment>::NodeCache::local = {NULL, 0, false, false};
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+std::atomic<size_t> RBTree<T, Compare, Multi, Threaded, Augment>::NodeCache::capacity(0);
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void* RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode::operator new(size_t size) {
+    return NodeCache::allocate(size);
 }
 
-template <typename T>
-RBTree<T>::~RBTree() {
-    if (root != NULL) {
-        delete root;
-    }
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode::operator delete(void* memory) {
+    NodeCache::release(memory);
 }
 
-template <typename T>
-bool RBTree<T>::contains(const T key) {
-    if (root == NULL) {
-        return false;
-    } else {
-        return root->lookup(key) != NULL;
-    }
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::NodeCache::Depot&
+         RBTree<T, Compare, Multi, Threaded, Augment>::NodeCache::depot() {
+    //Never destroyed, trees with static storage may release nodes at exit
+    static Depot* shared = new Depot();
+    return *shared;
 }
 
-template <typename T>
-bool RBTree<T>::insert(const T key) {
-    if (root == NULL) {
-        root = new RBTreeNode(key, this);
-        return true;
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void* RBTree<T, Compare, Multi, Threaded, Augment>::NodeCache::allocate(size_t size) {
+    Local& cache = local;
+
+    //A thread that has ended keeps no list, nobody would return it
+    if (cache.closed) {
+        return ::operator new(size);
     }
 
-    return root->insert(key);
-}
+    if (cache.head == NULL && batches() > 0) {
+        //The thread may only allocate, so the batch is returned when it ends
+        registerFlush(cache);
 
-template <typename T>
-bool RBTree<T>::remove(const T key) {
-    if (root == NULL) {
-        return false;
-    } else {
-        RBTreeNode* node = root->lookup(key);
+        Depot& shared = depot();
+        std::lock_guard<std::mutex> guard(shared.lock);
 
-        if (node == NULL) {
-            return false;
-        } else {
-            node->remove();
-            return true;
+        if (!shared.batches.empty()) {
+            cache.head = shared.batches.back();
+            cache.count = BATCH_SIZE;
+            shared.batches.pop_back();
         }
     }
-}
 
-//iterator
-template <typename T>
-typename RBTree<T>::iterator& RBTree<T>::iterator::operator++ () {
-    //Perform a post-order tree traversal
-    RBTreeNode* node = this->node;
-    
-    //The root node is the last element
-    if (node->parent == NULL) {
-        this->node = NULL;
-        return *this;
-    }
-    
-    //Switch to the right sibling or bubble up in the tree
-    if (node == node->parent->left && node->parent->right != NULL) {
-        node = node->parent->right;
-        
-    } else {
-        this->node = node->parent;
-        return *this;
-    }
-    
-    //Descend to the next leaf node
-    while (true) {
-        if (node->left != NULL) {
-            node = node->left;
-            
-        } else if (node->right != NULL) {
-            node = node->right;
-            
-        } else {
-            this->node = node;
-            return *this;
-        }
+    if (cache.head == NULL) {
+        return ::operator new(size);
     }
+
+    void* memory = cache.head;
+    cache.head = nextFree(memory);
+    cache.count--;
+    return memory;
 }
 
-template <typename T>
-typename RBTree<T>::iterator RBTree<T>::begin() {
-    //The first node will be the minimum node
-    RBTreeNode* node = root;
-    
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::NodeCache::release(void* memory) {
+    Local& cache = local;
+
+    if (cache.closed) {
+        ::operator delete(memory);
+        return;
+    }
+
+    //A disabled cache also frees the list the thread still holds
+    if (batches() == 0) {
+        freeList(cache.head);
+        cache.head = NULL;
+        cache.count = 0;
+        ::operator delete(memory);
+        return;
+    }
+
+    registerFlush(cache);
+
+    nextFree(memory) = cache.head;
+    cache.head = memory;
+    cache.count++;
+
+    //A full list keeps one batch, so alternating frees and allocations
+    //do not move the same batch back and forth
+    if (cache.count >= 2 * BATCH_SIZE) {
+        transfer(cache);
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::NodeCache::registerFlush(Local& cache) {
+    if (!cache.registered) {
+        static thread_local LocalFlush flush;
+        (void)flush;
+        cache.registered = true;
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::NodeCache::transfer(Local& cache) {
+    //Detach the first BATCH_SIZE nodes of the free list
+    void* batch = cache.head;
+    void* last = batch;
+
+    for (size_t i = 1; i < BATCH_SIZE; i++) {
+        last = nextFree(last);
+    }
+
+    cache.head = nextFree(last);
+    cache.count -= BATCH_SIZE;
+    nextFree(last) = NULL;
+
+    {
+        Depot& shared = depot();
+        std::lock_guard<std::mutex> guard(shared.lock);
+
+        if (shared.batches.size() < batches()) {
+            try {
+                shared.batches.push_back(batch);
+                return;
+            } catch (...) {}
+        }
+    }
+
+    //The depot is full, the batch goes back to the allocator
+    freeList(batch);
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::NodeCache::freeList(void* head) {
+    while (head != NULL) {
+        void* next = nextFree(head);
+        ::operator delete(head);
+        head = next;
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+RBTree<T, Compare, Multi, Threaded, Augment>::NodeCache::LocalFlush::~LocalFlush() {
+    Local& cache = local;
+    cache.closed = true;
+
+    while (cache.count >= BATCH_SIZE) {
+        transfer(cache);
+    }
+
+    freeList(cache.head);
+    cache.head = NULL;
+    cache.count = 0;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::NodeCache::resize(size_t batches) {
+    capacity.store(batches, std::memory_order_relaxed);
+
+    std::vector<void*> excess;
+
+    {
+        Depot& shared = depot();
+        std::lock_guard<std::mutex> guard(shared.lock);
+
+        while (shared.batches.size() > batches) {
+            excess.push_back(shared.batches.back());
+            shared.batches.pop_back();
+        }
+    }
+
+    for (size_t i = 0; i < excess.size(); i++) {
+        freeList(excess[i]);
+    }
+
+    //Other threads use up their lists with their next allocations and free
+    //them with their next release or when they end
+    if (batches == 0) {
+        Local& cache = local;
+        freeList(cache.head);
+        cache.head = NULL;
+        cache.count = 0;
+    }
+}
+
+//Node arena
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::NodeArena::releaseBlock(Block* block) {
+    if (block != NULL && block->live.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        block->~Block();
+        free(block);
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode* 
+         RBTree<T, Compare, Multi, Threaded, Augment>::NodeArena::create(const RBTreeNode* source, RBTreeNode* parent) {
+    //Copy the key, multiplicity and color of a node into the next free slot
+    RBTreeNode* node = create(source->key, source->getCount());
+    node->parent = parent;
+    node->color = source->color;
+    node->setAugment(source->getAugment());
+    return node;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename K>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode* 
+         RBTree<T, Compare, Multi, Threaded, Augment>::NodeArena::create(K&& key, unsigned int count) {
+    //Create a detached black node in the next free slot
+    bool single = !usable || created + expected < SINGLE_NODES;
+    created++;
+    expected -= (expected > 0) ? 1 : 0;
+
+    if (single) {
+        RBTreeNode* node = new RBTreeNode(std::forward<K>(key));
+        node->setCount(count);
+        return node;
+    }
+
+    if (next == NULL || next + sizeof(RBTreeNode) > end) {
+        //The current node and the expected ones, or as many as before
+        size_t nodes = (expected > 0) ? expected + 1 : created;
+        size_t size = HEADER_SIZE + nodes * sizeof(RBTreeNode);
+        void* memory;
+
+        if (size > BLOCK_SIZE) {
+            size = BLOCK_SIZE;
+        }
+
+        if (posix_memalign(&memory, BLOCK_SIZE, size) != 0) {
+            throw std::bad_alloc();
+        }
+
+        //The arena itself holds a reference until the block is full
+        releaseBlock(block);
+        block = new (memory) Block();
+        block->live.store(1, std::memory_order_relaxed);
+        next = static_cast<char*>(memory) + HEADER_SIZE;
+        end = static_cast<char*>(memory) + size;
+    }
+
+    RBTreeNode* node = new (next) RBTreeNode(std::forward<K>(key));
+    node->setCount(count);
+    node->pooled = true;
+
+    block->live.fetch_add(1, std::memory_order_relaxed);
+    next += sizeof(RBTreeNode);
+    return node;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::NodeArena::release(RBTreeNode* node) {
+    Block* block = reinterpret_cast<Block*>(reinterpret_cast<uintptr_t>(node) & ~(uintptr_t)(BLOCK_SIZE - 1));
+    node->~RBTreeNode();
+    releaseBlock(block);
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::release(RBTreeNode* node) {
+    //Free a single detached node depending on its storage
+    if (node->pooled) {
+        NodeArena::release(node);
+    } else {
+        delete node;
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode* RBTree<T, Compare, Multi, Threaded, Augment>::clone(const RBTreeNode* source) {
+    //Copy the shape and the colors of a tree without any comparisons or fixups.
+    //The nodes are created in pre-order into an arena, so that a parent and its
+    //left child are usually next to each other in memory.
+    if (source == NULL) {
+        return NULL;
+    }
+
+    NodeArena arena;
+    const RBTreeNode* from = source;
+    RBTreeNode* copy = arena.create(from, NULL);
+    RBTreeNode* to = copy;
+
+    //Walk through the source without a stack, a missing copy of a child means
+    //that the subtree of the child was not visited yet
+    while (true) {
+        const RBTreeNode* child = NULL;
+        bool leftChild = false;
+
+        if (from->left != NULL && to->left == NULL) {
+            child = from->left;
+            leftChild = true;
+        } else if (from->right != NULL && to->right == NULL) {
+            child = from->right;
+        }
+
+        if (child != NULL) {
+            RBTreeNode* node = arena.create(child, to);
+
+            if (leftChild) {
+                to->left = node;
+            } else {
+                to->right = node;
+            }
+
+            from = child;
+            to = node;
+
+        } else if (from == source) {
+            return copy;
+
+        } else {
+            from = from->parent;
+            to = to->parent;
+        }
+    }
+}
+
+//tree
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+RBTree<T, Compare, Multi, Threaded, Augment>::RBTree() : comp() {
+    this->root = NULL;
+    this->deferred = false;
+    this->relayout = NULL;
+    this->jumps = NULL;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+RBTree<T, Compare, Multi, Threaded, Augment>::RBTree(const Compare& comp) : comp(comp) {
+    this->root = NULL;
+    this->deferred = false;
+    this->relayout = NULL;
+    this->jumps = NULL;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+RBTree<T, Compare, Multi, Threaded, Augment>::RBTree(const RBTree<T, Compare, Multi, Threaded, Augment>& other) : comp(other.comp) {
+    this->root = clone(other.root);
+    linkInOrder(this->root);
+    this->deferred = other.deferred;
+    this->relayout = NULL;
+
+    //The copy has its own nodes, only the size of the table is taken
+    this->jumps = (other.jumps == NULL) ? NULL : new JumpTable(other.jumps->bits);
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+RBTree<T, Compare, Multi, Threaded, Augment>::RBTree(RBTree<T, Compare, Multi, Threaded, Augment>&& other) : comp(other.comp) {
+    this->root = other.root;
+    this->deferred = other.deferred;
+    this->relayout = other.relayout;
+    this->jumps = other.jumps;
+    other.root = NULL;
+    other.relayout = NULL;
+    other.jumps = NULL;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+RBTree<T, Compare, Multi, Threaded, Augment>::~RBTree() {
+    clear();
+    delete relayout;
+    delete jumps;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+RBTree<T, Compare, Multi, Threaded, Augment>& RBTree<T, Compare, Multi, Threaded, Augment>::operator= (const RBTree<T, Compare, Multi, Threaded, Augment>& other) {
+    if (this != &other) {
+        RBTree<T, Compare, Multi, Threaded, Augment> copy(other);
+        swap(copy);
+    }
+
+    return *this;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+RBTree<T, Compare, Multi, Threaded, Augment>& RBTree<T, Compare, Multi, Threaded, Augment>::operator= (RBTree<T, Compare, Multi, Threaded, Augment>&& other) {
+    //The old nodes are released together with the other tree
+    swap(other);
+    return *this;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::swap(RBTree<T, Compare, Multi, Threaded, Augment>& other) {
+    std::swap(root, other.root);
+    std::swap(comp, other.comp);
+    std::swap(deferred, other.deferred);
+    std::swap(relayout, other.relayout);
+    std::swap(jumps, other.jumps);
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::clear() {
+    if (root == NULL) {
+        return;
+    }
+
+    if (deferred) {
+        RBTreeReclaimer::instance().retire(root, &destroyDetached);
+    } else {
+        destroy(root);
+    }
+
+    root = NULL;
+    invalidateJumps();
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::setDeferredDestruction(bool deferred) {
+    this->deferred = deferred;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::setJumpTable(unsigned int bits) {
+    static_assert(JUMPABLE, "The jump table needs integer keys in ascending order");
+
+    delete jumps;
+    jumps = (bits == 0) ? NULL : new JumpTable(std::min(bits, 30u));
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+bool RBTree<T, Compare, Multi, Threaded, Augment>::jumpBucket(uint64_t ordinal, size_t& bucket) const {
+    if (ordinal < jumps->base || ((ordinal - jumps->base) >> jumps->shift) >= jumps->buckets.size()) {
+        return false;
+    }
+
+    bucket = (size_t)((ordinal - jumps->base) >> jumps->shift);
+    return true;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::rebuildJumps() {
+    //Spread the buckets over the current range of keys
+    RBTreeNode* last = root;
+
+    while (last->right != NULL) {
+        last = last->right;
+    }
+
+    uint64_t low = RBTreeJumpKey<T>::ordinal(minimum(root)->key);
+    uint64_t span = RBTreeJumpKey<T>::ordinal(last->key) - low;
+    size_t size = (size_t)1 << jumps->bits;
+    unsigned int shift = 0;
+
+    while ((span >> shift) >= size) {
+        shift++;
+    }
+
+    jumps->buckets.assign(size, NULL);
+    jumps->base = low;
+    jumps->shift = shift;
+    jumps->misses = 0;
+    jumps->stale = false;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename K>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode* RBTree<T, Compare, Multi, Threaded, Augment>::jumpStart(const K& key) {
+    //Heterogeneous keys and trees without a table start at the root
+    if (!JUMPABLE || !std::is_same<K, T>::value || jumps == NULL || root == NULL) {
+        return root;
+    }
+
+    if (jumps->stale) {
+        rebuildJumps();
+    }
+
+    uint64_t ordinal = RBTreeJumpKey<K>::ordinal(key);
+    size_t bucket;
+
+    if (!jumpBucket(ordinal, bucket)) {
+        //The keys have left the range, it is chosen again after as many
+        //misses as there are buckets
+        if (++jumps->misses > jumps->buckets.size()) {
+            jumps->stale = true;
+        }
+
+        return root;
+    }
+
+    RBTreeNode* node = jumps->buckets[bucket];
+
+    if (node != NULL && node->jumpTarget) {
+        return node;
+    }
+
+    //A bucket without keys starts at the end of the path, which is only
+    //valid until the next change of the tree
+    RBTreeNode* last;
+    node = bucketRoot(bucket, last);
+
+    if (node == NULL) {
+        return last;
+    }
+
+    node->jumpTarget = true;
+    jumps->buckets[bucket] = node;
+    return node;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode* 
+         RBTree<T, Compare, Multi, Threaded, Augment>::bucketRoot(size_t bucket, RBTreeNode*& last) {
+    //Find the first node on the path with a key of the bucket, the keys above
+    //it send all keys of the bucket the same way
+    uint64_t low = jumps->base + ((uint64_t)bucket << jumps->shift);
+    uint64_t high = low + (((uint64_t)1 << jumps->shift) - 1);
+    high = (high < low) ? UINT64_MAX : high;
+
+    RBTreeNode* node = root;
+    last = root;
+
+    while (node != NULL) {
+        uint64_t position = RBTreeJumpKey<T>::ordinal(node->key);
+        last = node;
+
+        if (position < low) {
+            node = node->right;
+        } else if (position > high) {
+            node = node->left;
+        } else {
+            return node;
+        }
+    }
+
+    return NULL;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::dropJump(RBTreeNode* node) {
+    //A node is removed from the tree, the table must not point to it anymore
+    size_t bucket;
+
+    if (JUMPABLE && jumps != NULL && !jumps->stale &&
+        jumpBucket(RBTreeJumpKey<T>::ordinal(node->key), bucket) && jumps->buckets[bucket] == node) {
+        jumps->buckets[bucket] = NULL;
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename K>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode* 
+         RBTree<T, Compare, Multi, Threaded, Augment>::lowerBound(const K& key, RBTreeNode* subtree) {
+    //Find the first node of the subtree that is not ordered before the key
+    RBTreeNode* node = subtree;
+    RBTreeNode* bound = NULL;
+
+    if (BRANCHLESS) {
+        while (node != NULL) {
+            bool greater = comp(node->key, key);
+            bound = select(greater, node, bound);
+            node = select(greater, node->left, node->right);
+        }
+
+        return bound;
+    }
+
+    while (node != NULL) {
+        if (comp(node->key, key)) {
+            node = node->right;
+        } else {
+            bound = node;
+            node = node->left;
+        }
+    }
+
+    return bound;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode* RBTree<T, Compare, Multi, Threaded, Augment>::minimum(RBTreeNode* node) {
     if (node != NULL) {
         while (node->left != NULL) {
             node = node->left;
         }
-        
-        while (node->right != NULL) {
+    }
+
+    return node;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode* RBTree<T, Compare, Multi, Threaded, Augment>::successor(RBTreeNode* node) {
+    //Threaded trees follow the link instead of walking up the tree
+    return Threaded ? node->getNext() : treeSuccessor(node);
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode* RBTree<T, Compare, Multi, Threaded, Augment>::predecessor(RBTreeNode* node) {
+    return Threaded ? node->getPrev() : treePredecessor(node);
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode* 
+         RBTree<T, Compare, Multi, Threaded, Augment>::treePredecessor(RBTreeNode* node) {
+    //The predecessor is the maximum of the left subtree
+    if (node->left != NULL) {
+        node = node->left;
+
+        while (node->right != NULL) {
+            node = node->right;
+        }
+
+        return node;
+    }
+
+    while (node->parent != NULL && node == node->parent->left) {
+        node = node->parent;
+    }
+
+    return node->parent;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename Augment::value_type RBTree<T, Compare, Multi, Threaded, Augment>::computeAugment(const RBTreeNode* node) {
+    //The childs are expected to be up to date
+    typename Augment::value_type value = Augment::of(node->key, node->getCount());
+
+    if (node->left != NULL) value = Augment::combine(node->left->getAugment(), value);
+    if (node->right != NULL) value = Augment::combine(value, node->right->getAugment());
+    return value;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::augment(RBTreeNode* node) {
+    if (AUGMENTED) {
+        node->setAugment(computeAugment(node));
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::augmentPath(RBTreeNode* node) {
+    //Update a changed node and all of its ancestors
+    for (; AUGMENTED && node != NULL; node = node->parent) {
+        augment(node);
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::augmentAll(RBTreeNode* treeRoot) {
+    //Post-order walk without a stack, a node is updated when it is left
+    //towards its parent, so both childs are already up to date
+    if (!AUGMENTED || treeRoot == NULL) {
+        return;
+    }
+
+    RBTreeNode* stop = treeRoot->parent;
+    RBTreeNode* node = treeRoot;
+    RBTreeNode* from = stop;
+
+    while (node != stop) {
+        RBTreeNode* next;
+
+        if (from == node->parent && node->left != NULL) {
+            next = node->left;
+        } else if (from != node->right && node->right != NULL) {
+            next = node->right;
+        } else {
+            augment(node);
+            next = node->parent;
+        }
+
+        from = node;
+        node = next;
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::linkBetween(RBTreeNode* node, RBTreeNode* prev, RBTreeNode* next) {
+    if (!Threaded) return;
+
+    node->setPrev(prev);
+    node->setNext(next);
+
+    if (prev != NULL) prev->setNext(node);
+    if (next != NULL) next->setPrev(node);
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::unlinkInOrder(RBTreeNode* node) {
+    if (!Threaded) return;
+
+    RBTreeNode* prev = node->getPrev();
+    RBTreeNode* next = node->getNext();
+
+    if (prev != NULL) prev->setNext(next);
+    if (next != NULL) next->setPrev(prev);
+
+    node->setPrev(NULL);
+    node->setNext(NULL);
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::linkInOrder(RBTreeNode** nodes, size_t count) {
+    if (!Threaded) return;
+
+    for (size_t i = 0; i < count; i++) {
+        nodes[i]->setPrev((i > 0) ? nodes[i - 1] : NULL);
+        nodes[i]->setNext((i + 1 < count) ? nodes[i + 1] : NULL);
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::linkInOrder(RBTreeNode* treeRoot) {
+    if (!Threaded) return;
+
+    RBTreeNode* prev = NULL;
+
+    for (RBTreeNode* node = minimum(treeRoot); node != NULL; node = treeSuccessor(node)) {
+        node->setPrev(prev);
+        node->setNext(NULL);
+
+        if (prev != NULL) prev->setNext(node);
+        prev = node;
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode* 
+         RBTree<T, Compare, Multi, Threaded, Augment>::treeSuccessor(RBTreeNode* node) {
+    //The successor is the minimum of the right subtree
+    if (node->right != NULL) {
+        return minimum(node->right);
+    }
+
+    //Otherwise bubble up until we leave a left subtree
+    while (node->parent != NULL && node == node->parent->right) {
+        node = node->parent;
+    }
+
+    //The parent is null after the maximum node
+    return node->parent;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+int RBTree<T, Compare, Multi, Threaded, Augment>::blackHeight(RBTreeNode* node) {
+    //Every path has the same number of black nodes, so the left spine is enough
+    int height = 0;
+
+    while (node != NULL) {
+        height += node->isBlack();
+        node = node->left;
+    }
+
+    return height;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode* 
+         RBTree<T, Compare, Multi, Threaded, Augment>::join(RBTreeNode* left, RBTreeNode* middle, RBTreeNode* right) {
+    //Join two trees where all keys of left < middle < all keys of right
+    //The roots are colored black, which is always valid for a root
+    if (left != NULL) {
+        left->parent = NULL;
+        left->color = RBTreeNode::BLACK;
+    }
+
+    if (right != NULL) {
+        right->parent = NULL;
+        right->color = RBTreeNode::BLACK;
+    }
+
+    int leftHeight = blackHeight(left);
+    int rightHeight = blackHeight(right);
+
+    if (leftHeight == rightHeight) {
+        middle->parent = NULL;
+        middle->left = left;
+        middle->right = right;
+        middle->color = RBTreeNode::BLACK;
+
+        if (left != NULL) left->parent = middle;
+        if (right != NULL) right->parent = middle;
+        augment(middle);
+        return middle;
+    }
+
+    RBTreeNode* treeRoot;
+    RBTreeNode* parent = NULL;
+    RBTreeNode* node;
+
+    if (leftHeight > rightHeight) {
+        //Find a black node on the right spine of the higher tree with the same black height
+        treeRoot = left;
+        node = left;
+        int height = leftHeight;
+
+        while (node != NULL && !(node->isBlack() && height == rightHeight)) {
+            height -= node->isBlack();
+            parent = node;
+            node = node->right;
+        }
+
+        //The middle node replaces the found node and adopts it as left child
+        middle->left = node;
+        middle->right = right;
+        parent->right = middle;
+
+    } else {
+        //Symmetric case on the left spine of the right tree
+        treeRoot = right;
+        node = right;
+        int height = rightHeight;
+
+        while (node != NULL && !(node->isBlack() && height == leftHeight)) {
+            height -= node->isBlack();
+            parent = node;
+            node = node->left;
+        }
+
+        middle->left = left;
+        middle->right = node;
+        parent->left = middle;
+    }
+
+    middle->parent = parent;
+    middle->color = RBTreeNode::RED;
+
+    if (middle->left != NULL) middle->left->parent = middle;
+    if (middle->right != NULL) middle->right->parent = middle;
+
+    //The red middle node may have a red parent, repair it like an insertion
+    augmentPath(middle);
+    middle->adjustInsert(middle, treeRoot);
+    return treeRoot;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode* 
+         RBTree<T, Compare, Multi, Threaded, Augment>::join(RBTreeNode* left, RBTreeNode* right) {
+    //Join two trees where all keys of left < all keys of right
+    if (left == NULL) {
+        if (right != NULL) right->parent = NULL;
+        return right;
+    }
+
+    if (right == NULL) {
+        left->parent = NULL;
+        return left;
+    }
+
+    //Use the minimum of the right tree as the middle node
+    right->parent = NULL;
+    right->color = RBTreeNode::BLACK;
+
+    RBTreeNode* middle = minimum(right);
+    RBTreeNode* prev = middle->getPrev();
+    RBTreeNode* next = middle->getNext();
+
+    //The middle node keeps its in-order neighbours
+    middle->unlink(right);
+    linkBetween(middle, prev, next);
+    return join(left, middle, right);
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename K>
+void RBTree<T, Compare, Multi, Threaded, Augment>::split(RBTreeNode* node, const K& key, RBTreeNode*& left, RBTreeNode*& right) {
+    //Split the tree into the keys lower than the key and all other keys
+    RBTreeNode* path[MAX_HEIGHT];
+    RBTreeNode* subtree[MAX_HEIGHT];
+    bool lower[MAX_HEIGHT];
+    int depth = 0;
+
+    //Remember the search path and the subtrees that hang off the path
+    while (node != NULL) {
+        lower[depth] = comp(node->key, key);
+        subtree[depth] = lower[depth] ? node->left : node->right;
+        path[depth] = node;
+        node = lower[depth] ? node->right : node->left;
+        depth++;
+    }
+
+    left = NULL;
+    right = NULL;
+
+    //Join the pieces bottom-up, the costs sum up to O(log n)
+    while (depth-- > 0) {
+        RBTreeNode* middle = path[depth];
+        middle->parent = NULL;
+        middle->left = NULL;
+        middle->right = NULL;
+
+        if (lower[depth]) {
+            left = join(subtree[depth], middle, left);
+        } else {
+            right = join(right, middle, subtree[depth]);
+        }
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+int RBTree<T, Compare, Multi, Threaded, Augment>::deepestLevel(size_t count) {
+    int depth = 0;
+
+    for (size_t n = count; n > 1; n >>= 1) {
+        depth++;
+    }
+
+    return depth;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode* 
+         RBTree<T, Compare, Multi, Threaded, Augment>::build(RBTreeNode** nodes, size_t count) {
+    RBTreeNode* treeRoot = buildRange(nodes, {0, count, NULL, false, 0}, deepestLevel(count), -1, NULL);
+    augmentAll(treeRoot);
+    return treeRoot;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode* 
+         RBTree<T, Compare, Multi, Threaded, Augment>::buildRange(RBTreeNode** nodes, BuildRange range, int redDepth,
+                                               int cutDepth, std::vector<BuildRange>* cut) {
+    //Link sorted nodes into a balanced tree. All levels except the deepest
+    //one are complete, so only the nodes on the deepest level are colored red.
+    //Non-empty ranges on the cut depth are collected instead of being linked.
+    BuildRange stack[MAX_HEIGHT];
+    int top = 0;
+    RBTreeNode* rangeRoot = NULL;
+
+    stack[top++] = range;
+
+    while (top > 0) {
+        BuildRange range = stack[--top];
+        RBTreeNode* node = NULL;
+
+        if (range.from < range.to && range.depth == cutDepth) {
+            cut->push_back(range);
+            continue;
+        }
+
+        if (range.from < range.to) {
+            size_t middle = range.from + (range.to - range.from) / 2;
+            node = nodes[middle];
+            node->parent = range.parent;
+            node->color = (range.depth == redDepth && range.depth > 0)
+                          ? RBTreeNode::RED
+                          : RBTreeNode::BLACK;
+
+            stack[top++] = {middle + 1, range.to, node, false, range.depth + 1};
+            stack[top++] = {range.from, middle, node, true, range.depth + 1};
+        }
+
+        if (range.parent == NULL) {
+            rangeRoot = node;
+        } else if (range.leftChild) {
+            range.parent->left = node;
+        } else {
+            range.parent->right = node;
+        }
+    }
+
+    return rangeRoot;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+size_t RBTree<T, Compare, Multi, Threaded, Augment>::destroy(RBTreeNode* node) {
+    //Free a subtree without recursion and without a stack by rotating
+    //left childs up until the current node can be deleted
+    size_t count = 0;
+
+    while (node != NULL) {
+        if (node->left != NULL) {
+            RBTreeNode* left = node->left;
+            node->left = left->right;
+            left->right = node;
+            node = left;
+
+        } else {
+            RBTreeNode* right = node->right;
+            count += node->getCount();
+            release(node);
+            node = right;
+        }
+    }
+
+    return count;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+size_t RBTree<T, Compare, Multi, Threaded, Augment>::destroyDetached(void* node) {
+    return destroy(static_cast<RBTreeNode*>(node));
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+size_t RBTree<T, Compare, Multi, Threaded, Augment>::eraseNodes(const T& from, const T* to) {
+    //Detach the keys in [from, to) as a separate tree and join the rest
+    RBTreeNode* left;
+    RBTreeNode* middle;
+    RBTreeNode* right = NULL;
+
+    //The remaining neighbours of the erased range are linked in advance
+    if (Threaded) {
+        RBTreeNode* first = lowerBound(from, root);
+        RBTreeNode* last = (to == NULL) ? NULL : lowerBound(*to, root);
+
+        if (first != NULL) {
+            RBTreeNode* prev = first->getPrev();
+
+            if (prev != NULL) prev->setNext(last);
+            if (last != NULL) last->setPrev(prev);
+        }
+    }
+
+    split(root, from, left, middle);
+
+    if (to != NULL) {
+        split(middle, *to, middle, right);
+    }
+
+    size_t removed = destroy(middle);
+    root = join(left, right);
+    invalidateJumps();
+    return removed;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+bool RBTree<T, Compare, Multi, Threaded, Augment>::insertNode(RBTreeNode* node) {
+    //Link a detached node into the tree
+    node->left = NULL;
+    node->right = NULL;
+    node->parent = NULL;
+
+    if (root == NULL) {
+        node->color = RBTreeNode::BLACK;
+        linkBetween(node, NULL, NULL);
+        augment(node);
+        root = node;
+        return true;
+    }
+
+    RBTreeNode* parent = root;
+
+    while (true) {
+        if (comp(parent->key, node->key)) {
+            if (parent->right == NULL) {
+                parent->right = node;
+                break;
+            }
+
+            parent = parent->right;
+
+        } else if (comp(node->key, parent->key)) {
+            if (parent->left == NULL) {
+                parent->left = node;
+                break;
+            }
+
+            parent = parent->left;
+
+        } else {
+            //Duplicates are only accepted by multisets
+            if (!Multi) return false;
+
+            parent->setCount(parent->getCount() + node->getCount());
+            augmentPath(parent);
+            release(node);
+            return true;
+        }
+    }
+
+    node->parent = parent;
+    node->color = RBTreeNode::RED;
+
+    if (parent->right == node) {
+        linkBetween(node, parent, parent->getNext());
+    } else {
+        linkBetween(node, parent->getPrev(), parent);
+    }
+
+    augmentPath(node);
+    node->adjustInsert(node, root);
+    return true;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename K>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode* RBTree<T, Compare, Multi, Threaded, Augment>::lookup(const K& key) {
+    //An existing key is always below the start of the jump table
+    RBTreeNode* start = jumpStart(key);
+
+    //The branchless descent does not stop early, the bound is checked once
+    if (BRANCHLESS) {
+        RBTreeNode* bound = lowerBound(key, start);
+        return (bound != NULL && !comp(key, bound->key)) ? bound : NULL;
+    }
+
+    if (start == NULL) {
+        return NULL;
+    } else {
+        return start->lookup(key, comp);
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename K>
+bool RBTree<T, Compare, Multi, Threaded, Augment>::removeKey(const K& key) {
+    RBTreeNode* node = lookup(key);
+
+    if (node == NULL) {
+        return false;
+    } else if (node->getCount() > 1) {
+        //Multiset nodes are only unlinked when the last copy is removed
+        node->setCount(node->getCount() - 1);
+        augmentPath(node);
+        return true;
+    } else {
+        dropJump(node);
+        node->remove(root);
+        return true;
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+bool RBTree<T, Compare, Multi, Threaded, Augment>::contains(const T& key) {
+    return lookup(key) != NULL;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename K, typename C, typename>
+bool RBTree<T, Compare, Multi, Threaded, Augment>::contains(const K& key) {
+    return lookup(key) != NULL;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+bool RBTree<T, Compare, Multi, Threaded, Augment>::insert(const T& key) {
+    if (root == NULL) {
+        root = new RBTreeNode(key);
+        augment(root);
+        return true;
+    }
+
+    return jumpStart(key)->insert(key, comp, root);
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+bool RBTree<T, Compare, Multi, Threaded, Augment>::remove(const T& key) {
+    return removeKey(key);
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename K, typename C, typename>
+bool RBTree<T, Compare, Multi, Threaded, Augment>::remove(const K& key) {
+    return removeKey(key);
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+unsigned int RBTree<T, Compare, Multi, Threaded, Augment>::count(const T& key) {
+    RBTreeNode* node = lookup(key);
+    return (node == NULL) ? 0 : node->getCount();
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename K, typename C, typename>
+unsigned int RBTree<T, Compare, Multi, Threaded, Augment>::count(const K& key) {
+    RBTreeNode* node = lookup(key);
+    return (node == NULL) ? 0 : node->getCount();
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::iterator RBTree<T, Compare, Multi, Threaded, Augment>::find(const T& key) {
+    return iterator(lookup(key));
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename K, typename C, typename>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::iterator RBTree<T, Compare, Multi, Threaded, Augment>::find(const K& key) {
+    return iterator(lookup(key));
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::iterator RBTree<T, Compare, Multi, Threaded, Augment>::lower_bound(const T& key) {
+    return iterator(lowerBound(key, root));
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename K, typename C, typename>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::iterator RBTree<T, Compare, Multi, Threaded, Augment>::lower_bound(const K& key) {
+    return iterator(lowerBound(key, root));
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::node_type RBTree<T, Compare, Multi, Threaded, Augment>::extract(iterator position) {
+    RBTreeNode* node = position.node;
+
+    if (node != NULL) {
+        dropJump(node);
+        node->unlink(root);
+    }
+
+    return node_type(node);
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::node_type RBTree<T, Compare, Multi, Threaded, Augment>::extract(const T& key) {
+    return extract(iterator(lookup(key)));
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename K, typename C, typename>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::node_type RBTree<T, Compare, Multi, Threaded, Augment>::extract(const K& key) {
+    return extract(iterator(lookup(key)));
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+bool RBTree<T, Compare, Multi, Threaded, Augment>::insert(node_type&& handle) {
+    //The handle keeps the node when the key is already in the tree
+    if (handle.node == NULL || !insertNode(handle.node)) {
+        return false;
+    }
+
+    handle.node = NULL;
+    return true;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename InputIterator>
+void RBTree<T, Compare, Multi, Threaded, Augment>::insert(InputIterator first, InputIterator last) {
+    std::vector<T> keys(first, last);
+    std::sort(keys.begin(), keys.end(), comp);
+
+    //The length of the left spine estimates the size of the tree, a single
+    //insert costs about as much. Rebuilding costs a step for every node.
+    size_t depth = 1;
+
+    for (RBTreeNode* node = root; node != NULL && depth < 8 * sizeof(size_t) - 1; node = node->left) {
+        depth++;
+    }
+
+    if (keys.size() * depth < ((size_t)1 << depth)) {
+        for (size_t i = 0; i < keys.size(); i++) {
+            insert(keys[i]);
+        }
+
+        return;
+    }
+
+    std::vector<RBTreeNode*> existing;
+    flatten(root, existing);
+    root = NULL;
+    invalidateJumps();
+
+    std::vector<RBTreeNode*> nodes;
+    std::vector<RBTreeNode*> created;
+    nodes.reserve(existing.size() + keys.size());
+
+    try {
+        NodeArena arena;
+        size_t next = 0;
+
+        //Merge the old nodes with the new keys, duplicates of a key only
+        //increase the multiplicity of a multiset node
+        for (size_t i = 0; i < keys.size(); ) {
+            while (next < existing.size() && comp(existing[next]->key, keys[i])) {
+                nodes.push_back(existing[next++]);
+            }
+
+            size_t to = i + 1;
+
+            while (to < keys.size() && !comp(keys[i], keys[to])) {
+                to++;
+            }
+
+            unsigned int copies = Multi ? (unsigned int)(to - i) : 1;
+
+            if (next < existing.size() && !comp(keys[i], existing[next]->key)) {
+                if (Multi) existing[next]->setCount(existing[next]->getCount() + copies);
+            } else {
+                created.push_back(arena.create(keys[i], copies));
+                nodes.push_back(created.back());
+            }
+
+            i = to;
+        }
+
+        nodes.insert(nodes.end(), existing.begin() + next, existing.end());
+
+    } catch (...) {
+        //Restore the old nodes, the new ones are dropped
+        for (size_t i = 0; i < created.size(); i++) {
+            release(created[i]);
+        }
+
+        root = build(existing.data(), existing.size());
+        linkInOrder(existing.data(), existing.size());
+        throw;
+    }
+
+    root = build(nodes.data(), nodes.size());
+    linkInOrder(nodes.data(), nodes.size());
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::merge(RBTree<T, Compare, Multi, Threaded, Augment>& other) {
+    //Splice all nodes with new keys from the other tree into this tree.
+    //The successor is determined first, unlinking a node does not move others.
+    RBTreeNode* node = minimum(other.root);
+    other.invalidateJumps();
+
+    while (node != NULL) {
+        RBTreeNode* next = successor(node);
+
+        if (Multi || lookup(node->key) == NULL) {
+            node->unlink(other.root);
+            insertNode(node);
+        }
+
+        node = next;
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::iterator RBTree<T, Compare, Multi, Threaded, Augment>::erase(iterator first, iterator last) {
+    //Partially erased multiset nodes keep their remaining copies
+    if (first.node != NULL && first.node == last.node) {
+        first.node->setCount(first.node->getCount() - (last.repeat - first.repeat));
+        augmentPath(first.node);
+        last.repeat = first.repeat;
+        return last;
+    }
+
+    if (first.repeat > 0) {
+        first.node->setCount(first.repeat);
+        augmentPath(first.node);
+        first = iterator(successor(first.node));
+    }
+
+    if (last.repeat > 0) {
+        last.node->setCount(last.node->getCount() - last.repeat);
+        augmentPath(last.node);
+        last.repeat = 0;
+    }
+
+    if (first != last) {
+        eraseNodes(first.node->key, (last.node == NULL) ? NULL : &last.node->key);
+    }
+
+    return last;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+size_t RBTree<T, Compare, Multi, Threaded, Augment>::erase_range(const T& from, const T& to) {
+    //Erase all keys in [from, to)
+    if (!comp(from, to)) {
+        return 0;
+    }
+
+    return eraseNodes(from, &to);
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::flatten(RBTreeNode* treeRoot, std::vector<RBTreeNode*>& nodes) {
+    //Collect the nodes in order by rotating left childs up like destroy(),
+    //the tree structure is given up
+    RBTreeNode* node = treeRoot;
+
+    while (node != NULL) {
+        if (node->left != NULL) {
+            RBTreeNode* left = node->left;
+            node->left = left->right;
+            left->right = node;
+            node = left;
+
+        } else {
+            nodes.push_back(node);
             node = node->right;
         }
     }
-    
-    return iterator(node);
 }
 
-template <typename T>
-typename RBTree<T>::iterator RBTree<T>::end()   {
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename Predicate>
+size_t RBTree<T, Compare, Multi, Threaded, Augment>::erase_if(Predicate pred) {
+    //Flatten the tree in order like destroy(), so that matching nodes can be
+    //deleted right away while the remaining nodes are collected in order
+    std::vector<RBTreeNode*> nodes;
+    RBTreeNode* node = root;
+    size_t removed = 0;
+
+    while (node != NULL) {
+        if (node->left != NULL) {
+            RBTreeNode* left = node->left;
+            node->left = left->right;
+            left->right = node;
+            node = left;
+
+        } else {
+            RBTreeNode* right = node->right;
+
+            if (pred(node->key)) {
+                removed += node->getCount();
+                release(node);
+            } else {
+                nodes.push_back(node);
+            }
+
+            node = right;
+        }
+    }
+
+    //Rebuild the remaining nodes instead of repairing the tree for every removal
+    root = build(nodes.data(), nodes.size());
+    linkInOrder(nodes.data(), nodes.size());
+    invalidateJumps();
+
+    return removed;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+std::vector<typename RBTree<T, Compare, Multi, Threaded, Augment>::Segment> RBTree<T, Compare, Multi, Threaded, Augment>::segments(size_t subtrees) {
+    //Replace every subtree by its left subtree, its root and its right subtree
+    //level by level until there are enough subtrees. The order stays in-order.
+    std::vector<Segment> list;
+    size_t whole = 0;
+    bool split = true;
+
+    if (root != NULL) {
+        list.push_back({root, true});
+        whole = 1;
+    }
+
+    while (whole < subtrees && split) {
+        std::vector<Segment> next;
+        next.reserve(list.size() * 2 + 1);
+        whole = 0;
+        split = false;
+
+        for (size_t i = 0; i < list.size(); i++) {
+            Segment segment = list[i];
+
+            if (!segment.whole || (segment.node->left == NULL && segment.node->right == NULL)) {
+                next.push_back(segment);
+                whole += segment.whole;
+                continue;
+            }
+
+            if (segment.node->left != NULL) {
+                next.push_back({segment.node->left, true});
+                whole++;
+            }
+
+            next.push_back({segment.node, false});
+
+            if (segment.node->right != NULL) {
+                next.push_back({segment.node->right, true});
+                whole++;
+            }
+
+            split = true;
+        }
+
+        list.swap(next);
+    }
+
+    return list;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename Function>
+void RBTree<T, Compare, Multi, Threaded, Augment>::visit(const Segment& segment, Function& fn) {
+    RBTreeNode* node = segment.node;
+    RBTreeNode* stop = NULL;
+
+    if (segment.whole) {
+        //The traversal ends at the successor of the subtree
+        stop = node;
+
+        while (stop->parent != NULL && stop == stop->parent->right) {
+            stop = stop->parent;
+        }
+
+        stop = stop->parent;
+        node = minimum(node);
+    } else {
+        stop = successor(node);
+    }
+
+    while (node != stop) {
+        for (unsigned int i = 0; i < node->getCount(); i++) {
+            fn(static_cast<const T&>(node->key));
+        }
+
+        node = successor(node);
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+unsigned int RBTree<T, Compare, Multi, Threaded, Augment>::workerCount(unsigned int threads) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+
+    return (threads == 0) ? 1 : threads;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename Function>
+void RBTree<T, Compare, Multi, Threaded, Augment>::runParallel(size_t tasks, unsigned int threads, Function fn) {
+    //The workers and the calling thread take the next task until all are
+    //done. The first exception is passed on to the calling thread.
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    auto work = [&]() {
+        size_t task;
+
+        while ((task = next++) < tasks) {
+            try {
+                fn(task);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+
+                if (!error) {
+                    error = std::current_exception();
+                }
+
+                next = tasks;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    for (unsigned int i = 1; i < threads && i < tasks; i++) {
+        workers.emplace_back(work);
+    }
+
+    work();
+
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename Function>
+void RBTree<T, Compare, Multi, Threaded, Augment>::parallel_for_each(Function fn, unsigned int threads) {
+    threads = workerCount(threads);
+    std::vector<Segment> list = segments(threads * SEGMENTS_PER_THREAD);
+
+    runParallel(list.size(), threads, [&](size_t i) {
+        visit(list[i], fn);
+    });
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename Value, typename Reduce, typename Combine>
+Value RBTree<T, Compare, Multi, Threaded, Augment>::parallel_reduce(Value init, Reduce reduce, Combine combine, unsigned int threads) {
+    //Wrapped results, a vector<bool> could not be written concurrently
+    struct Result {
+        Value value;
+    };
+
+    threads = workerCount(threads);
+    std::vector<Segment> list = segments(threads * SEGMENTS_PER_THREAD);
+    std::vector<Result> results(list.size(), Result{init});
+
+    runParallel(list.size(), threads, [&](size_t i) {
+        Value value = init;
+        auto step = [&](const T& key) { value = reduce(value, key); };
+
+        visit(list[i], step);
+        results[i].value = value;
+    });
+
+    if (results.empty()) {
+        return init;
+    }
+
+    Value value = results[0].value;
+
+    for (size_t i = 1; i < results.size(); i++) {
+        value = combine(value, results[i].value);
+    }
+
+    return value;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::RBTreeNode* 
+         RBTree<T, Compare, Multi, Threaded, Augment>::relocate(RBTreeNode* node, NodeArena& arena) {
+    //Move the key into a new node at the same position in the tree
+    RBTreeNode* copy = arena.create(std::move(node->key), node->getCount());
+    copy->color = node->color;
+    copy->setAugment(node->getAugment());
+    copy->parent = node->parent;
+    copy->left = node->left;
+    copy->right = node->right;
+
+    if (node->parent == NULL) {
+        root = copy;
+    } else if (node->parent->left == node) {
+        node->parent->left = copy;
+    } else {
+        node->parent->right = copy;
+    }
+
+    if (copy->left != NULL) copy->left->parent = copy;
+    if (copy->right != NULL) copy->right->parent = copy;
+
+    linkBetween(copy, node->getPrev(), node->getNext());
+    dropJump(node);
+    release(node);
+    return copy;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::defragment() {
+    delete relayout;
+    relayout = NULL;
+
+    if (root == NULL) {
+        return;
+    }
+
+    //Number of levels of a block that fit into a page
+    int levels = 1;
+
+    while ((((size_t)2 << levels) - 1) * sizeof(RBTreeNode) <= 4096) {
+        levels++;
+    }
+
+    //Determine the new order first: the top levels of a subtree in breadth-first
+    //order, followed by the blocks below it from left to right
+    std::vector<RBTreeNode*> order;
+    std::vector<RBTreeNode*> pending(1, root);
+
+    while (!pending.empty()) {
+        size_t level = order.size();
+        order.push_back(pending.back());
+        pending.pop_back();
+
+        for (int depth = 1; depth < levels; depth++) {
+            size_t end = order.size();
+
+            for (size_t i = level; i < end; i++) {
+                if (order[i]->left != NULL) order.push_back(order[i]->left);
+                if (order[i]->right != NULL) order.push_back(order[i]->right);
+            }
+
+            level = end;
+        }
+
+        for (size_t i = order.size(); i-- > level; ) {
+            if (order[i]->right != NULL) pending.push_back(order[i]->right);
+            if (order[i]->left != NULL) pending.push_back(order[i]->left);
+        }
+    }
+
+    NodeArena arena(order.size());
+
+    for (size_t i = 0; i < order.size(); i++) {
+        relocate(order[i], arena);
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+bool RBTree<T, Compare, Multi, Threaded, Augment>::defragment_step(size_t budget) {
+    if (root != NULL && relayout == NULL) {
+        relayout = new Relayout(minimum(root)->key);
+    }
+
+    //Continue with the first key that was not moved yet
+    RBTreeNode* node = (root == NULL) ? NULL : lowerBound(relayout->next, root);
+
+    for (size_t i = 0; i < budget && node != NULL; i++) {
+        RBTreeNode* next = successor(node);
+        relocate(node, relayout->arena);
+        node = next;
+    }
+
+    if (node == NULL) {
+        delete relayout;
+        relayout = NULL;
+        return true;
+    }
+
+    relayout->next = node->key;
+    return false;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::parallelSort(std::vector<T>& keys, unsigned int threads) {
+    //Sort one chunk per thread and merge neighbouring chunks pairwise
+    size_t chunks = std::min<size_t>(threads, keys.size() / 1024 + 1);
+    std::vector<size_t> bounds(chunks + 1);
+
+    for (size_t i = 0; i <= chunks; i++) {
+        bounds[i] = keys.size() * i / chunks;
+    }
+
+    runParallel(chunks, threads, [&](size_t i) {
+        std::sort(keys.begin() + bounds[i], keys.begin() + bounds[i + 1], comp);
+    });
+
+    for (size_t width = 1; width < chunks; width *= 2) {
+        size_t pairs = (chunks + 2 * width - 1) / (2 * width);
+
+        runParallel(pairs, threads, [&](size_t i) {
+            size_t from = bounds[2 * i * width];
+            size_t middle = bounds[std::min(chunks, (2 * i + 1) * width)];
+            size_t to = bounds[std::min(chunks, (2 * i + 2) * width)];
+
+            std::inplace_merge(keys.begin() + from, keys.begin() + middle, keys.begin() + to, comp);
+        });
+    }
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+template <typename InputIterator>
+void RBTree<T, Compare, Multi, Threaded, Augment>::assign_parallel(InputIterator first, InputIterator last, unsigned int threads) {
+    //The keys are copied first, the range may belong to this tree
+    std::vector<T> keys(first, last);
+    clear();
+
+    threads = workerCount(threads);
+    parallelSort(keys, threads);
+
+    //Slices start at the first copy of a key, so duplicates are never split
+    size_t slices = std::min<size_t>(threads * SEGMENTS_PER_THREAD, keys.size());
+    std::vector<size_t> bounds(slices + 1, keys.size());
+
+    for (size_t i = 0; i < slices; i++) {
+        size_t bound = std::max(keys.size() * i / slices, (i > 0) ? bounds[i - 1] : 0);
+
+        while (bound > 0 && bound < keys.size() && !comp(keys[bound - 1], keys[bound])) {
+            bound++;
+        }
+
+        bounds[i] = bound;
+    }
+
+    std::vector<std::vector<RBTreeNode*>> created(slices);
+
+    try {
+        runParallel(slices, threads, [&](size_t i) {
+            NodeArena arena(bounds[i + 1] - bounds[i]);
+
+            for (size_t from = bounds[i]; from < bounds[i + 1]; ) {
+                size_t to = from + 1;
+
+                while (to < bounds[i + 1] && !comp(keys[from], keys[to])) {
+                    to++;
+                }
+
+                created[i].push_back(arena.create(keys[from], Multi ? (unsigned int)(to - from) : 1));
+                from = to;
+            }
+        });
+    } catch (...) {
+        for (size_t i = 0; i < slices; i++) {
+            for (size_t k = 0; k < created[i].size(); k++) {
+                release(created[i][k]);
+            }
+        }
+
+        throw;
+    }
+
+    std::vector<RBTreeNode*> nodes;
+    nodes.reserve(keys.size());
+
+    for (size_t i = 0; i < slices; i++) {
+        nodes.insert(nodes.end(), created[i].begin(), created[i].end());
+    }
+
+    //Link the top levels, then the subtrees below them concurrently. The
+    //subtrees are linked into different child slots, so no lock is needed.
+    std::vector<BuildRange> cut;
+    int redDepth = deepestLevel(nodes.size());
+    int cutDepth = deepestLevel(threads * SEGMENTS_PER_THREAD) + 1;
+
+    root = buildRange(nodes.data(), {0, nodes.size(), NULL, false, 0}, redDepth, cutDepth, &cut);
+    linkInOrder(nodes.data(), nodes.size());
+
+    runParallel(cut.size(), threads, [&](size_t i) {
+        buildRange(nodes.data(), cut[i], redDepth, -1, NULL);
+    });
+
+    augmentAll(root);
+}
+
+//iterator
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::iterator& RBTree<T, Compare, Multi, Threaded, Augment>::iterator::operator++ () {
+    //Repeat the key of multiset nodes according to the multiplicity
+    if (++this->repeat < this->node->getCount()) {
+        return *this;
+    }
+
+    //Perform an in-order tree traversal
+    this->repeat = 0;
+    this->node = successor(this->node);
+    return *this;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::iterator& RBTree<T, Compare, Multi, Threaded, Augment>::iterator::operator-- () {
+    if (this->repeat > 0) {
+        this->repeat--;
+        return *this;
+    }
+
+    //The previous node starts with its last copy
+    this->node = predecessor(this->node);
+
+    if (this->node != NULL) {
+        this->repeat = this->node->getCount() - 1;
+    }
+
+    return *this;
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::iterator RBTree<T, Compare, Multi, Threaded, Augment>::begin() {
+    //The first node will be the minimum node
+    return iterator(minimum(root));
+}
+
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+typename RBTree<T, Compare, Multi, Threaded, Augment>::iterator RBTree<T, Compare, Multi, Threaded, Augment>::end()   {
     return iterator(NULL);
 }
 
 #ifdef DEBUG
-template <typename T>
-bool RBTree<T>::invariant() {
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+bool RBTree<T, Compare, Multi, Threaded, Augment>::invariant() {
+    //The in-order links must match the tree structure
+    RBTreeNode* prev = NULL;
+
+    for (RBTreeNode* node = minimum(root); Threaded && node != NULL; node = treeSuccessor(node)) {
+        if (node->getPrev() != prev || (prev != NULL && prev->getNext() != node)) {
+            return false;
+        }
+
+        prev = node;
+    }
+
+    if (prev != NULL && prev->getNext() != NULL) {
+        return false;
+    }
+
+    //A valid bucket of the jump table points to a node of the bucket, which
+    //is found again by a descent from the root
+    for (size_t i = 0; jumps != NULL && !jumps->stale && i < jumps->buckets.size(); i++) {
+        RBTreeNode* node = jumps->buckets[i];
+
+        if (node == NULL || !node->jumpTarget) {
+            continue;
+        }
+
+        RBTreeNode* last;
+
+        if (bucketRoot(i, last) != node) {
+            return false;
+        }
+    }
+
     //The root is empty or black
     return root == NULL || (
         root->isBlack() &&
-        root->invariant()
+        root->parent == NULL &&
+        root->invariant(comp)
     );
 }
 
-template <typename T>
-void RBTree<T>::dumpTree(string dumpName) {
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+void RBTree<T, Compare, Multi, Threaded, Augment>::dumpTree(string dumpName) {
     system("mkdir -p dump");
     ofstream graphFile;
     graphFile.open("dump/" + dumpName + ".gv");
@@ -738,8 +3168,8 @@ void RBTree<T>::dumpTree(string dumpName) {
     system(openCall.c_str());
 }
 
-template <typename T>
-string RBTree<T>::toString() {
+template <typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+string RBTree<T, Compare, Multi, Threaded, Augment>::toString() {
     stringstream buffer;
 
     if (root == NULL) {
@@ -752,4 +3182,28 @@ string RBTree<T>::toString() {
 }
 #endif
 
+template<typename T, typename Compare, bool Multi, bool Threaded, typename Augment>
+inline void swap(RBTree<T, Compare, Multi, Threaded, Augment>& first, RBTree<T, Compare, Multi, Threaded, Augment>& second) {
+    first.swap(second);
+}
+
+template<typename T, typename Compare, bool Multi, bool Threaded, typename Augment, typename Function>
+inline void parallel_for_each(RBTree<T, Compare, Multi, Threaded, Augment>& tree, Function fn, unsigned int threads = 0) {
+    tree.parallel_for_each(fn, threads);
+}
+
+template<typename T, typename Compare, bool Multi, bool Threaded, typename Augment, typename Value, typename Reduce, typename Combine>
+inline Value parallel_reduce(RBTree<T, Compare, Multi, Threaded, Augment>& tree, Value init, Reduce reduce,
+                             Combine combine, unsigned int threads = 0) {
+    return tree.parallel_reduce(init, reduce, combine, threads);
+}
+
+//Multiset flavor, duplicates are counted in the existing node
+template<typename T, typename Compare = std::less<T>>
+using RBMultiTree = RBTree<T, Compare, true>;
+
+//Threaded flavor, every node links to its in-order neighbours
+template<typename T, typename Compare = std::less<T>>
+using RBThreadedTree = RBTree<T, Compare, false, true>;
+
 #endif /* RBTREE_H */
\ No newline at end of file
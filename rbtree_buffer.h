@@ -0,0 +1,162 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+#ifndef RBTREE_BUFFER_H
+#define RBTREE_BUFFER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "rbtree.h"
+
+//Tree with a write buffer in front of it for bursts of inserts. An insert
+//only appends the key to the buffer. The buffer is merged into the tree as
+//one batch when it is full or when the tree is read in order, a batch that
+//is large compared to the tree is merged in O(n + m) without any fixups.
+template<typename T, typename Compare = std::less<T>>
+class RBBufferedTree {
+public:
+    typedef typename RBTree<T, Compare>::iterator iterator;
+
+    //Keys that are buffered until the buffer is merged
+    static const size_t DEFAULT_CAPACITY = 64 * 1024;
+
+private:
+    RBTree<T, Compare> tree;
+    std::vector<T> buffer;
+    size_t capacity;
+
+    //The buffer is sorted up to this position, later keys are unsorted
+    size_t sorted;
+    Compare comp;
+
+    void sortBuffer();
+
+public:
+    explicit RBBufferedTree(size_t capacity = DEFAULT_CAPACITY);
+    RBBufferedTree(size_t capacity, const Compare& comp);
+
+    //The key is buffered, duplicates are dropped when the buffer is merged
+    void insert(const T& key);
+
+    template<typename InputIterator>
+    void insert(InputIterator first, InputIterator last);
+
+    //Searches the tree and the buffer without merging it
+    bool contains(const T& key);
+    unsigned int count(const T& key);
+
+    //Operations that need the node of a key merge the buffer first
+    bool remove(const T& key);
+    iterator find(const T& key);
+    void flush();
+    void clear();
+
+    inline bool empty() const { return tree.empty() && buffer.empty(); }
+    inline size_t buffered() const { return buffer.size(); }
+
+    #ifdef DEBUG
+    bool invariant();
+    #endif
+
+    inline iterator begin() {
+        flush();
+        return tree.begin();
+    }
+
+    inline iterator end() { return tree.end(); }
+};
+
+template <typename T, typename Compare>
+RBBufferedTree<T, Compare>::RBBufferedTree(size_t capacity)
+    : tree(), capacity(capacity), sorted(0), comp() {}
+
+template <typename T, typename Compare>
+RBBufferedTree<T, Compare>::RBBufferedTree(size_t capacity, const Compare& comp)
+    : tree(comp), capacity(capacity), sorted(0), comp(comp) {}
+
+template <typename T, typename Compare>
+void RBBufferedTree<T, Compare>::insert(const T& key) {
+    buffer.push_back(key);
+
+    if (buffer.size() >= capacity) {
+        flush();
+    }
+}
+
+template <typename T, typename Compare>
+template <typename InputIterator>
+void RBBufferedTree<T, Compare>::insert(InputIterator first, InputIterator last) {
+    buffer.insert(buffer.end(), first, last);
+
+    if (buffer.size() >= capacity) {
+        flush();
+    }
+}
+
+template <typename T, typename Compare>
+void RBBufferedTree<T, Compare>::sortBuffer() {
+    //Only the keys appended since the last lookup have to be sorted
+    if (sorted < buffer.size()) {
+        std::sort(buffer.begin() + sorted, buffer.end(), comp);
+        std::inplace_merge(buffer.begin(), buffer.begin() + sorted, buffer.end(), comp);
+        sorted = buffer.size();
+    }
+}
+
+template <typename T, typename Compare>
+bool RBBufferedTree<T, Compare>::contains(const T& key) {
+    if (tree.contains(key)) {
+        return true;
+    }
+
+    sortBuffer();
+    return std::binary_search(buffer.begin(), buffer.end(), key, comp);
+}
+
+template <typename T, typename Compare>
+unsigned int RBBufferedTree<T, Compare>::count(const T& key) {
+    return contains(key) ? 1 : 0;
+}
+
+template <typename T, typename Compare>
+bool RBBufferedTree<T, Compare>::remove(const T& key) {
+    flush();
+    return tree.remove(key);
+}
+
+template <typename T, typename Compare>
+typename RBBufferedTree<T, Compare>::iterator RBBufferedTree<T, Compare>::find(const T& key) {
+    flush();
+    return tree.find(key);
+}
+
+template <typename T, typename Compare>
+void RBBufferedTree<T, Compare>::flush() {
+    if (!buffer.empty()) {
+        tree.insert(buffer.begin(), buffer.end());
+        buffer.clear();
+        sorted = 0;
+    }
+}
+
+template <typename T, typename Compare>
+void RBBufferedTree<T, Compare>::clear() {
+    tree.clear();
+    buffer.clear();
+    sorted = 0;
+}
+
+#ifdef DEBUG
+template <typename T, typename Compare>
+bool RBBufferedTree<T, Compare>::invariant() {
+    return sorted <= buffer.size() && std::is_sorted(buffer.begin(), buffer.begin() + sorted, comp) &&
+           tree.invariant();
+}
+#endif
+
+#endif /* RBTREE_BUFFER_H */
@@ -0,0 +1,188 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+#ifndef RBTREE_CACHE_H
+#define RBTREE_CACHE_H
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "rbtree.h"
+
+//Tree with a small direct-mapped cache of recently found nodes in front of
+//it. A lookup of a hot key compares against a single cached node instead of
+//descending the tree. Each slot has a reference bit like a CLOCK cache, so a
+//cold key has to miss twice before it replaces a recently used key. Rotations
+//only relink nodes, so a cached node stays valid until its key is removed.
+template<typename T, typename Compare = std::less<T>, typename Hash = std::hash<T>>
+class RBCachedTree {
+public:
+    typedef typename RBTree<T, Compare>::iterator iterator;
+
+    //Slots of the default cache, small enough to stay in the L1 cache
+    static const size_t DEFAULT_SLOTS = 256;
+
+private:
+    struct Slot {
+        iterator node;
+        bool referenced;
+    };
+
+    RBTree<T, Compare> tree;
+    std::vector<Slot> slots;
+    size_t mask;
+    Compare comp;
+    Hash hash;
+
+    inline Slot& slot(const T& key) { return slots[hash(key) & mask]; }
+    inline bool holds(Slot& entry, const T& key);
+
+public:
+    //The number of slots is rounded up to a power of two
+    explicit RBCachedTree(size_t slotCount = DEFAULT_SLOTS);
+    RBCachedTree(size_t slotCount, const Compare& comp, const Hash& hash);
+    RBCachedTree(const RBCachedTree<T, Compare, Hash>& other);
+
+    RBCachedTree<T, Compare, Hash>& operator= (const RBCachedTree<T, Compare, Hash>& other);
+
+    bool contains(const T& key);
+    bool insert(const T& key);
+    bool remove(const T& key);
+    unsigned int count(const T& key);
+    iterator find(const T& key);
+    void clear();
+
+    inline bool empty() const { return tree.empty(); }
+    inline size_t slotCount() const { return slots.size(); }
+
+    #ifdef DEBUG
+    bool invariant();
+    #endif
+
+    inline iterator begin() { return tree.begin(); }
+    inline iterator end() { return tree.end(); }
+};
+
+template <typename T, typename Compare, typename Hash>
+RBCachedTree<T, Compare, Hash>::RBCachedTree(size_t slotCount)
+    : RBCachedTree(slotCount, Compare(), Hash()) {}
+
+template <typename T, typename Compare, typename Hash>
+RBCachedTree<T, Compare, Hash>::RBCachedTree(size_t slotCount, const Compare& comp, const Hash& hash)
+    : tree(comp), comp(comp), hash(hash) {
+    size_t size = 1;
+
+    while (size < slotCount) {
+        size *= 2;
+    }
+
+    slots.assign(size, Slot{tree.end(), false});
+    mask = size - 1;
+}
+
+template <typename T, typename Compare, typename Hash>
+RBCachedTree<T, Compare, Hash>::RBCachedTree(const RBCachedTree<T, Compare, Hash>& other)
+    : tree(other.tree), slots(other.slots.size(), Slot{tree.end(), false}),
+      mask(other.mask), comp(other.comp), hash(other.hash) {
+    //The cached nodes belong to the other tree, the copy starts empty
+}
+
+template <typename T, typename Compare, typename Hash>
+RBCachedTree<T, Compare, Hash>& RBCachedTree<T, Compare, Hash>::operator= (const RBCachedTree<T, Compare, Hash>& other) {
+    if (this != &other) {
+        tree = other.tree;
+        slots.assign(other.slots.size(), Slot{tree.end(), false});
+        mask = other.mask;
+        comp = other.comp;
+        hash = other.hash;
+    }
+
+    return *this;
+}
+
+template <typename T, typename Compare, typename Hash>
+inline bool RBCachedTree<T, Compare, Hash>::holds(Slot& entry, const T& key) {
+    return entry.node != tree.end() && !comp(*entry.node, key) && !comp(key, *entry.node);
+}
+
+template <typename T, typename Compare, typename Hash>
+typename RBCachedTree<T, Compare, Hash>::iterator RBCachedTree<T, Compare, Hash>::find(const T& key) {
+    Slot& entry = slot(key);
+
+    if (holds(entry, key)) {
+        entry.referenced = true;
+        return entry.node;
+    }
+
+    //A referenced key gets a second chance, otherwise it is replaced
+    iterator it = tree.find(key);
+
+    if (it != tree.end()) {
+        if (entry.referenced) {
+            entry.referenced = false;
+        } else {
+            entry.node = it;
+        }
+    }
+
+    return it;
+}
+
+template <typename T, typename Compare, typename Hash>
+bool RBCachedTree<T, Compare, Hash>::contains(const T& key) {
+    return find(key) != tree.end();
+}
+
+template <typename T, typename Compare, typename Hash>
+unsigned int RBCachedTree<T, Compare, Hash>::count(const T& key) {
+    return contains(key) ? 1 : 0;
+}
+
+template <typename T, typename Compare, typename Hash>
+bool RBCachedTree<T, Compare, Hash>::insert(const T& key) {
+    //Nodes are not moved by an insert, so the cache stays valid
+    return tree.insert(key);
+}
+
+template <typename T, typename Compare, typename Hash>
+bool RBCachedTree<T, Compare, Hash>::remove(const T& key) {
+    //A key can only be cached in its own slot
+    Slot& entry = slot(key);
+
+    if (holds(entry, key)) {
+        entry = Slot{tree.end(), false};
+    }
+
+    return tree.remove(key);
+}
+
+template <typename T, typename Compare, typename Hash>
+void RBCachedTree<T, Compare, Hash>::clear() {
+    tree.clear();
+    slots.assign(slots.size(), Slot{tree.end(), false});
+}
+
+#ifdef DEBUG
+template <typename T, typename Compare, typename Hash>
+bool RBCachedTree<T, Compare, Hash>::invariant() {
+    //Every cached node is still in the tree and sits in the slot of its key
+    for (size_t i = 0; i < slots.size(); i++) {
+        iterator node = slots[i].node;
+
+        if (node == tree.end()) {
+            continue;
+        }
+
+        if ((hash(*node) & mask) != i || tree.find(*node) != node) {
+            return false;
+        }
+    }
+
+    return tree.invariant();
+}
+#endif
+
+#endif /* RBTREE_CACHE_H */
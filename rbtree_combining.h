@@ -0,0 +1,272 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+#ifndef RBTREE_COMBINING_H
+#define RBTREE_COMBINING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "rbtree.h"
+
+//Tree for many threads with flat combining. A thread publishes its operation
+//in a slot of its own and tries to become the combiner. The combiner applies
+//all published operations as one batch sorted by key, so that successive
+//operations find the top of their paths in the cache, and posts the results.
+//The other threads only wait for their results instead of handing the lock
+//over one by one.
+template<typename T, typename Compare = std::less<T>>
+class RBCombiningTree {
+public:
+    //Slots of the default tree, more threads share slots
+    static const size_t DEFAULT_SLOTS = 64;
+
+private:
+    enum Operation : unsigned char {
+        CONTAINS = 0,
+        INSERT = 1,
+        REMOVE = 2,
+    };
+
+    enum State : unsigned int {
+        FREE = 0,
+        WRITING = 1,
+        PENDING = 2,
+        DONE = 3,
+    };
+
+    //Every slot has a cache line of its own, the key stays with the waiting thread
+    struct alignas(64) Slot {
+        std::atomic<unsigned int> state;
+        Operation operation;
+        bool result;
+        const T* key;
+        std::exception_ptr error;
+
+        Slot() : state(FREE), operation(CONTAINS), result(false), key(NULL) {}
+    };
+
+    //Scans of the slots by a combiner before it gives up the lock
+    static const int COMBINE_PASSES = 3;
+
+    RBTree<T, Compare> tree;
+    Slot* slots;
+    size_t slotCount;
+
+    //Slots below this bound have been used, the combiner only scans them
+    std::atomic<size_t> used;
+
+    std::mutex combiner;
+    std::vector<Slot*> batch;
+    Compare comp;
+
+    static size_t threadIndex();
+    bool submit(Operation operation, const T& key);
+    void collect();
+    void combine();
+
+public:
+    explicit RBCombiningTree(size_t slotCount = DEFAULT_SLOTS);
+    RBCombiningTree(size_t slotCount, const Compare& comp);
+    RBCombiningTree(const RBCombiningTree<T, Compare>&) = delete;
+    ~RBCombiningTree();
+
+    RBCombiningTree<T, Compare>& operator= (const RBCombiningTree<T, Compare>&) = delete;
+
+    bool contains(const T& key);
+    bool insert(const T& key);
+    bool remove(const T& key);
+
+    //Calls fn with the tree while no operations are applied, e.g. to iterate
+    template<typename Function>
+    void exclusive(Function fn);
+
+    #ifdef DEBUG
+    bool invariant();
+    #endif
+};
+
+template <typename T, typename Compare>
+RBCombiningTree<T, Compare>::RBCombiningTree(size_t slotCount)
+    : RBCombiningTree(slotCount, Compare()) {}
+
+template <typename T, typename Compare>
+RBCombiningTree<T, Compare>::RBCombiningTree(size_t slotCount, const Compare& comp)
+    : tree(comp), slotCount((slotCount == 0) ? 1 : slotCount), used(0), comp(comp) {
+    void* memory;
+
+    if (posix_memalign(&memory, alignof(Slot), this->slotCount * sizeof(Slot)) != 0) {
+        throw std::bad_alloc();
+    }
+
+    slots = static_cast<Slot*>(memory);
+
+    for (size_t i = 0; i < this->slotCount; i++) {
+        new (&slots[i]) Slot();
+    }
+
+    //A batch never allocates, so the combiner cannot fail between the requests
+    batch.reserve(this->slotCount);
+}
+
+template <typename T, typename Compare>
+RBCombiningTree<T, Compare>::~RBCombiningTree() {
+    for (size_t i = 0; i < slotCount; i++) {
+        slots[i].~Slot();
+    }
+
+    free(slots);
+}
+
+template <typename T, typename Compare>
+size_t RBCombiningTree<T, Compare>::threadIndex() {
+    //Consecutive indices, so up to slotCount threads do not share a slot
+    static std::atomic<size_t> next(0);
+    thread_local size_t index = next++;
+    return index;
+}
+
+template <typename T, typename Compare>
+bool RBCombiningTree<T, Compare>::submit(Operation operation, const T& key) {
+    //Threads with the same index probe for the next free slot
+    size_t index = threadIndex() % slotCount;
+
+    while (true) {
+        unsigned int expected = FREE;
+
+        if (slots[index].state.load(std::memory_order_relaxed) == FREE &&
+            slots[index].state.compare_exchange_strong(expected, WRITING, std::memory_order_acquire)) {
+            break;
+        }
+
+        index = (index + 1) % slotCount;
+
+        if (index == threadIndex() % slotCount) {
+            std::this_thread::yield();
+        }
+    }
+
+    size_t bound = used.load(std::memory_order_relaxed);
+
+    while (bound <= index && !used.compare_exchange_weak(bound, index + 1)) {}
+
+    Slot& slot = slots[index];
+    slot.operation = operation;
+    slot.key = &key;
+    slot.state.store(PENDING, std::memory_order_release);
+
+    //Either this thread becomes the combiner or another one applies the request
+    while (slot.state.load(std::memory_order_acquire) != DONE) {
+        if (combiner.try_lock()) {
+            std::lock_guard<std::mutex> lock(combiner, std::adopt_lock);
+            combine();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    bool result = slot.result;
+    std::exception_ptr error = slot.error;
+    slot.error = NULL;
+    slot.state.store(FREE, std::memory_order_release);
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    return result;
+}
+
+template <typename T, typename Compare>
+void RBCombiningTree<T, Compare>::collect() {
+    size_t bound = used.load(std::memory_order_acquire);
+    batch.clear();
+
+    for (size_t i = 0; i < bound; i++) {
+        if (slots[i].state.load(std::memory_order_acquire) == PENDING) {
+            batch.push_back(&slots[i]);
+        }
+    }
+}
+
+template <typename T, typename Compare>
+void RBCombiningTree<T, Compare>::combine() {
+    //Further passes take the requests that were published during a batch
+    for (int pass = 0; pass < COMBINE_PASSES; pass++) {
+        collect();
+
+        if (batch.empty()) {
+            return;
+        }
+
+        //Concurrent requests may be applied in any order, the key order
+        //keeps the shared part of the paths in the cache. When the comparator
+        //throws, the interrupted sort may have lost requests, so the batch is
+        //collected again and applied in the order of the slots.
+        try {
+            std::sort(batch.begin(), batch.end(), [this](const Slot* a, const Slot* b) {
+                return comp(*a->key, *b->key);
+            });
+        } catch (...) {
+            collect();
+        }
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            Slot& slot = *batch[i];
+
+            try {
+                switch (slot.operation) {
+                    case CONTAINS: slot.result = tree.contains(*slot.key); break;
+                    case INSERT: slot.result = tree.insert(*slot.key); break;
+                    case REMOVE: slot.result = tree.remove(*slot.key); break;
+                }
+            } catch (...) {
+                slot.error = std::current_exception();
+            }
+
+            slot.state.store(DONE, std::memory_order_release);
+        }
+    }
+}
+
+template <typename T, typename Compare>
+bool RBCombiningTree<T, Compare>::contains(const T& key) {
+    return submit(CONTAINS, key);
+}
+
+template <typename T, typename Compare>
+bool RBCombiningTree<T, Compare>::insert(const T& key) {
+    return submit(INSERT, key);
+}
+
+template <typename T, typename Compare>
+bool RBCombiningTree<T, Compare>::remove(const T& key) {
+    return submit(REMOVE, key);
+}
+
+template <typename T, typename Compare>
+template <typename Function>
+void RBCombiningTree<T, Compare>::exclusive(Function fn) {
+    std::lock_guard<std::mutex> lock(combiner);
+    fn(tree);
+}
+
+#ifdef DEBUG
+template <typename T, typename Compare>
+bool RBCombiningTree<T, Compare>::invariant() {
+    std::lock_guard<std::mutex> lock(combiner);
+    return tree.invariant();
+}
+#endif
+
+#endif /* RBTREE_COMBINING_H */
@@ -0,0 +1,397 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+#ifndef RBTREE_FILTER_H
+#define RBTREE_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <utility>
+
+#include "rbtree.h"
+
+//Blocked counting Bloom filter. All counters of a key are located in one
+//cache line, so a query touches a single line. The counters have 4 bits,
+//a saturated counter is never decremented again, which can only cause
+//false positives but no false negatives.
+class RBBloomFilter {
+public:
+    //Counters that are reserved for every key of the capacity
+    static const size_t COUNTERS_PER_KEY = 16;
+
+    //Counters that are set for a single key
+    static const unsigned int HASHES = 6;
+
+private:
+    static const size_t BLOCK_SIZE = 64;
+    static const size_t BLOCK_COUNTERS = 2 * BLOCK_SIZE;
+    static const unsigned int SATURATED = 15;
+
+    uint8_t* blocks;
+    size_t blockCount;
+    size_t keyCapacity;
+
+    static inline uint64_t mix(uint64_t hash);
+    inline uint8_t* block(uint64_t mixed) const;
+    static inline unsigned int position(uint64_t mixed, unsigned int i);
+    static inline unsigned int counter(const uint8_t* block, unsigned int position);
+    static inline void setCounter(uint8_t* block, unsigned int position, unsigned int value);
+    void allocate(size_t capacity);
+
+public:
+    explicit RBBloomFilter(size_t capacity);
+    RBBloomFilter(const RBBloomFilter& other);
+    RBBloomFilter(RBBloomFilter&& other) noexcept;
+    ~RBBloomFilter();
+
+    RBBloomFilter& operator= (const RBBloomFilter& other);
+    RBBloomFilter& operator= (RBBloomFilter&& other) noexcept;
+
+    void add(size_t hash);
+    void remove(size_t hash);
+    bool mayContain(size_t hash) const;
+    void clear();
+
+    //Frees the counters, they are allocated for capacity keys with the next add
+    void reset(size_t capacity) noexcept;
+
+    //Keys that fit in the filter with a low false positive rate
+    inline size_t capacity() const { return keyCapacity; }
+};
+
+inline RBBloomFilter::RBBloomFilter(size_t capacity) {
+    allocate(capacity);
+}
+
+inline RBBloomFilter::RBBloomFilter(const RBBloomFilter& other)
+    : blocks(NULL), blockCount(0), keyCapacity(other.keyCapacity) {
+    if (other.blocks != NULL) {
+        allocate(other.keyCapacity);
+        memcpy(blocks, other.blocks, blockCount * BLOCK_SIZE);
+    }
+}
+
+inline RBBloomFilter::RBBloomFilter(RBBloomFilter&& other) noexcept
+    : blocks(other.blocks), blockCount(other.blockCount), keyCapacity(other.keyCapacity) {
+    //The moved-from filter is empty and allocates with its next add
+    other.blocks = NULL;
+    other.blockCount = 0;
+    other.keyCapacity = 0;
+}
+
+inline RBBloomFilter::~RBBloomFilter() {
+    free(blocks);
+}
+
+inline RBBloomFilter& RBBloomFilter::operator= (const RBBloomFilter& other) {
+    if (this != &other) {
+        RBBloomFilter copy(other);
+        *this = std::move(copy);
+    }
+
+    return *this;
+}
+
+inline RBBloomFilter& RBBloomFilter::operator= (RBBloomFilter&& other) noexcept {
+    std::swap(blocks, other.blocks);
+    std::swap(blockCount, other.blockCount);
+    std::swap(keyCapacity, other.keyCapacity);
+    return *this;
+}
+
+inline void RBBloomFilter::allocate(size_t capacity) {
+    //At least one block, so an empty filter needs no special case
+    blockCount = (capacity * COUNTERS_PER_KEY + BLOCK_COUNTERS - 1) / BLOCK_COUNTERS;
+    blockCount = (blockCount == 0) ? 1 : blockCount;
+    keyCapacity = capacity;
+
+    void* memory;
+
+    if (posix_memalign(&memory, BLOCK_SIZE, blockCount * BLOCK_SIZE) != 0) {
+        throw std::bad_alloc();
+    }
+
+    blocks = static_cast<uint8_t*>(memory);
+    clear();
+}
+
+inline uint64_t RBBloomFilter::mix(uint64_t hash) {
+    //Finalizer of MurmurHash3, std::hash of integers is the identity
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+inline uint8_t* RBBloomFilter::block(uint64_t mixed) const {
+    //The upper half selects the block without a division
+    return blocks + (((mixed >> 32) * blockCount) >> 32) * BLOCK_SIZE;
+}
+
+inline unsigned int RBBloomFilter::position(uint64_t mixed, unsigned int i) {
+    //Double hashing on the lower half, the odd step makes all positions of
+    //a key distinct within the block
+    unsigned int start = (unsigned int)mixed;
+    unsigned int step = (unsigned int)(mixed >> 7) | 1;
+    return (start + i * step) & (BLOCK_COUNTERS - 1);
+}
+
+inline unsigned int RBBloomFilter::counter(const uint8_t* block, unsigned int position) {
+    return (block[position >> 1] >> ((position & 1) * 4)) & 0xf;
+}
+
+inline void RBBloomFilter::setCounter(uint8_t* block, unsigned int position, unsigned int value) {
+    unsigned int shift = (position & 1) * 4;
+    uint8_t& byte = block[position >> 1];
+    byte = (uint8_t)((byte & ~(0xf << shift)) | (value << shift));
+}
+
+inline void RBBloomFilter::add(size_t hash) {
+    if (blocks == NULL) {
+        allocate(keyCapacity);
+    }
+
+    uint64_t mixed = mix(hash);
+    uint8_t* line = block(mixed);
+
+    for (unsigned int i = 0; i < HASHES; i++) {
+        unsigned int value = counter(line, position(mixed, i));
+
+        if (value != SATURATED) {
+            setCounter(line, position(mixed, i), value + 1);
+        }
+    }
+}
+
+inline void RBBloomFilter::remove(size_t hash) {
+    if (blocks == NULL) {
+        return;
+    }
+
+    uint64_t mixed = mix(hash);
+    uint8_t* line = block(mixed);
+
+    for (unsigned int i = 0; i < HASHES; i++) {
+        unsigned int value = counter(line, position(mixed, i));
+
+        //A saturated counter does not know how often it was incremented
+        if (value != SATURATED && value != 0) {
+            setCounter(line, position(mixed, i), value - 1);
+        }
+    }
+}
+
+inline bool RBBloomFilter::mayContain(size_t hash) const {
+    //A filter without blocks has not been added to since it was moved from
+    if (blocks == NULL) {
+        return false;
+    }
+
+    uint64_t mixed = mix(hash);
+    const uint8_t* line = block(mixed);
+    bool present = true;
+
+    //No early exit, the counters are in the same line anyway
+    for (unsigned int i = 0; i < HASHES; i++) {
+        present &= (counter(line, position(mixed, i)) != 0);
+    }
+
+    return present;
+}
+
+inline void RBBloomFilter::reset(size_t capacity) noexcept {
+    free(blocks);
+    blocks = NULL;
+    blockCount = 0;
+    keyCapacity = capacity;
+}
+
+inline void RBBloomFilter::clear() {
+    if (blocks != NULL) {
+        memset(blocks, 0, blockCount * BLOCK_SIZE);
+    }
+}
+
+//Tree with a membership filter in front of it. A lookup of a key that is
+//definitely not in the tree is answered by the filter without touching a
+//single node. The filter is rebuilt from the tree when the number of keys
+//leaves the range it was sized for.
+template<typename T, typename Compare = std::less<T>, typename Hash = std::hash<T>>
+class RBFilteredTree {
+public:
+    typedef typename RBTree<T, Compare>::iterator iterator;
+
+    //Capacity of the filter of an empty tree
+    static const size_t MIN_CAPACITY = 1024;
+
+private:
+    RBTree<T, Compare> tree;
+    RBBloomFilter filter;
+    Hash hash;
+    size_t keys;
+
+    void rebuild(size_t capacity);
+
+public:
+    RBFilteredTree();
+    RBFilteredTree(const Compare& comp, const Hash& hash);
+    RBFilteredTree(const RBFilteredTree<T, Compare, Hash>& other) = default;
+
+    //The moved-from tree is empty and keeps a filter of the minimum capacity
+    RBFilteredTree(RBFilteredTree<T, Compare, Hash>&& other);
+
+    RBFilteredTree<T, Compare, Hash>& operator= (const RBFilteredTree<T, Compare, Hash>& other) = default;
+    RBFilteredTree<T, Compare, Hash>& operator= (RBFilteredTree<T, Compare, Hash>&& other);
+
+    bool contains(const T& key);
+    bool insert(const T& key);
+    bool remove(const T& key);
+    unsigned int count(const T& key);
+    iterator find(const T& key);
+    void clear();
+
+    inline bool empty() const { return keys == 0; }
+    inline size_t size() const { return keys; }
+
+    //Keys the current filter was sized for
+    inline size_t filterCapacity() const { return filter.capacity(); }
+
+    #ifdef DEBUG
+    bool invariant();
+    #endif
+
+    inline iterator begin() { return tree.begin(); }
+    inline iterator end() { return tree.end(); }
+};
+
+template <typename T, typename Compare, typename Hash>
+RBFilteredTree<T, Compare, Hash>::RBFilteredTree()
+    : tree(), filter(MIN_CAPACITY), hash(), keys(0) {}
+
+template <typename T, typename Compare, typename Hash>
+RBFilteredTree<T, Compare, Hash>::RBFilteredTree(const Compare& comp, const Hash& hash)
+    : tree(comp), filter(MIN_CAPACITY), hash(hash), keys(0) {}
+
+template <typename T, typename Compare, typename Hash>
+RBFilteredTree<T, Compare, Hash>::RBFilteredTree(RBFilteredTree<T, Compare, Hash>&& other)
+    : tree(std::move(other.tree)), filter(std::move(other.filter)), hash(other.hash), keys(other.keys) {
+    other.filter.reset(MIN_CAPACITY);
+    other.keys = 0;
+}
+
+template <typename T, typename Compare, typename Hash>
+RBFilteredTree<T, Compare, Hash>& RBFilteredTree<T, Compare, Hash>::operator= (RBFilteredTree<T, Compare, Hash>&& other) {
+    if (this != &other) {
+        //The old keys are released by the other tree
+        tree = std::move(other.tree);
+        filter = std::move(other.filter);
+        hash = other.hash;
+        keys = other.keys;
+
+        other.tree.clear();
+        other.filter.reset(MIN_CAPACITY);
+        other.keys = 0;
+    }
+
+    return *this;
+}
+
+template <typename T, typename Compare, typename Hash>
+void RBFilteredTree<T, Compare, Hash>::rebuild(size_t capacity) {
+    //A fresh filter also drops the saturated counters of removed keys
+    RBBloomFilter fresh(capacity);
+
+    for (iterator it = tree.begin(); it != tree.end(); ++it) {
+        fresh.add(hash(*it));
+    }
+
+    filter = std::move(fresh);
+}
+
+template <typename T, typename Compare, typename Hash>
+bool RBFilteredTree<T, Compare, Hash>::contains(const T& key) {
+    return filter.mayContain(hash(key)) && tree.contains(key);
+}
+
+template <typename T, typename Compare, typename Hash>
+bool RBFilteredTree<T, Compare, Hash>::insert(const T& key) {
+    if (!tree.insert(key)) {
+        return false;
+    }
+
+    keys++;
+
+    //Doubling keeps the rebuilds amortized constant per insert, the minimum
+    //also lets a filter without capacity grow
+    if (keys > filter.capacity()) {
+        size_t grown = filter.capacity() * 2;
+        rebuild((grown < MIN_CAPACITY) ? MIN_CAPACITY : grown);
+    } else {
+        filter.add(hash(key));
+    }
+
+    return true;
+}
+
+template <typename T, typename Compare, typename Hash>
+bool RBFilteredTree<T, Compare, Hash>::remove(const T& key) {
+    size_t keyHash = hash(key);
+
+    if (!filter.mayContain(keyHash) || !tree.remove(key)) {
+        return false;
+    }
+
+    keys--;
+    filter.remove(keyHash);
+
+    //Shrink only at a quarter, so alternating inserts and removes at the
+    //boundary do not rebuild every time
+    if (filter.capacity() > MIN_CAPACITY && keys < filter.capacity() / 4) {
+        rebuild(filter.capacity() / 2);
+    }
+
+    return true;
+}
+
+template <typename T, typename Compare, typename Hash>
+unsigned int RBFilteredTree<T, Compare, Hash>::count(const T& key) {
+    return contains(key) ? 1 : 0;
+}
+
+template <typename T, typename Compare, typename Hash>
+typename RBFilteredTree<T, Compare, Hash>::iterator RBFilteredTree<T, Compare, Hash>::find(const T& key) {
+    return filter.mayContain(hash(key)) ? tree.find(key) : tree.end();
+}
+
+template <typename T, typename Compare, typename Hash>
+void RBFilteredTree<T, Compare, Hash>::clear() {
+    tree.clear();
+    filter = RBBloomFilter(MIN_CAPACITY);
+    keys = 0;
+}
+
+#ifdef DEBUG
+template <typename T, typename Compare, typename Hash>
+bool RBFilteredTree<T, Compare, Hash>::invariant() {
+    //Every key in the tree has to pass the filter
+    size_t visited = 0;
+
+    for (iterator it = tree.begin(); it != tree.end(); ++it, visited++) {
+        if (!filter.mayContain(hash(*it))) {
+            return false;
+        }
+    }
+
+    return visited == keys && tree.invariant();
+}
+#endif
+
+#endif /* RBTREE_FILTER_H */
@@ -0,0 +1,106 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+#ifndef RBTREE_INTERVAL_H
+#define RBTREE_INTERVAL_H
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include "rbtree.h"
+
+//Closed interval [start, end] with the value it stands for, e.g. the id of a
+//session or a lease. Intervals with the same range and different values are
+//distinct entries.
+template<typename T, typename V = size_t>
+struct RBInterval {
+    T start;
+    T end;
+    V value;
+
+    RBInterval(const T& start, const T& end, const V& value = V()) : start(start), end(end), value(value) {}
+
+    inline bool overlaps(const T& from, const T& to) const { return !(to < start) && !(end < from); }
+    inline bool operator== (const RBInterval<T, V>& other) const {
+        return !(start < other.start) && !(other.start < start) && !(end < other.end) && !(other.end < end) &&
+               !(value < other.value) && !(other.value < value);
+    }
+};
+
+//Orders by the start, intervals with the same start by the end and equal
+//ranges by the value
+template<typename T, typename V = size_t>
+struct RBIntervalLess {
+    inline bool operator() (const RBInterval<T, V>& a, const RBInterval<T, V>& b) const {
+        if (a.start < b.start) return true;
+        if (b.start < a.start) return false;
+        if (a.end < b.end) return true;
+        if (b.end < a.end) return false;
+        return a.value < b.value;
+    }
+};
+
+//Every node knows the maximum end of its subtree
+template<typename T, typename V = size_t>
+struct RBIntervalAugment {
+    typedef T value_type;
+
+    static inline T of(const RBInterval<T, V>& key, unsigned int) { return key.end; }
+    static inline T combine(const T& a, const T& b) { return (a < b) ? b : a; }
+};
+
+//Interval tree keyed by the start of the intervals. All operations of RBTree
+//are available, the maximum ends are maintained by the tree.
+template<typename T, typename V = size_t>
+using RBIntervalTree = RBTree<RBInterval<T, V>, RBIntervalLess<T, V>, false, false, RBIntervalAugment<T, V>>;
+
+//Calls fn for all intervals overlapping [from, to] in the order of the start.
+//Subtrees that end before from are skipped and the walk stops at the first
+//start after to, so only the nodes above the reported intervals are visited.
+template<typename T, typename V, typename Function>
+void overlapping(RBIntervalTree<T, V>& tree, const T& from, const T& to, Function fn) {
+    typedef typename RBIntervalTree<T, V>::node_view View;
+
+    std::vector<View> path;
+    View node = tree.root_view();
+
+    while (true) {
+        while (node && !(node.augment() < from)) {
+            path.push_back(node);
+            node = node.left();
+        }
+
+        if (path.empty()) {
+            return;
+        }
+
+        node = path.back();
+        path.pop_back();
+
+        if (to < node.key().start) {
+            return;
+        }
+
+        if (!(node.key().end < from)) {
+            fn(node.key());
+        }
+
+        node = node.right();
+    }
+}
+
+//Calls fn for all intervals containing the point
+template<typename T, typename V, typename Function>
+inline void stabbing(RBIntervalTree<T, V>& tree, const T& point, Function fn) {
+    overlapping(tree, point, point, fn);
+}
+
+template<typename T, typename V>
+inline std::ostream& operator<< (std::ostream& stream, const RBInterval<T, V>& interval) {
+    return stream << "[" << interval.start << ", " << interval.end << "]";
+}
+
+#endif /* RBTREE_INTERVAL_H */
@@ -0,0 +1,303 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+#ifndef RBTREE_LAZY_H
+#define RBTREE_LAZY_H
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+
+#include "rbtree.h"
+
+//Tree with lazy removal. A remove only marks the node of the key as dead, the
+//tree is not changed. Lookups and iteration skip dead nodes and an insert of
+//a dead key revives its node. The dead nodes are removed physically by
+//compact() or step by step with compact_step(). When the dead nodes exceed a
+//ratio of all nodes, an incremental compaction is started that advances by a
+//few nodes with every following insert. A remove only marks its node, unless
+//the inserts do not keep up and the dead nodes pass the middle between the
+//ratio and all nodes.
+template<typename T, typename Compare = std::less<T>>
+class RBLazyTree {
+private:
+    //Key of a node with its removal mark, the mark is not part of the order
+    struct Entry {
+        T key;
+        mutable bool dead;
+
+        explicit Entry(const T& key) : key(key), dead(false) {}
+    };
+
+    //Compares entries and keys, so a lookup needs no temporary entry
+    struct EntryLess {
+        typedef void is_transparent;
+        Compare comp;
+
+        explicit EntryLess(const Compare& comp) : comp(comp) {}
+
+        inline bool operator() (const Entry& a, const Entry& b) const { return comp(a.key, b.key); }
+        inline bool operator() (const Entry& a, const T& b) const { return comp(a.key, b); }
+        inline bool operator() (const T& a, const Entry& b) const { return comp(a, b.key); }
+    };
+
+    typedef RBTree<Entry, EntryLess> Tree;
+
+public:
+    //Dead nodes that are tolerated before the tree is compacted
+    static constexpr double DEFAULT_DEAD_RATIO = 0.25;
+
+    //Nodes visited by the automatic compaction per insert
+    static const size_t AUTO_STEP = 16;
+
+    class iterator;
+
+private:
+    Tree tree;
+    size_t live;
+    size_t deadCount;
+    double deadRatio;
+
+    //Next node of an incremental compaction, the end when none is running.
+    //Only compactions remove nodes, so the node stays valid in between.
+    typename Tree::iterator cursor;
+
+    inline void autoStep() { if (cursor != tree.end()) compact_step(AUTO_STEP); }
+
+public:
+    //A ratio of 1 or more disables the automatic compaction
+    explicit RBLazyTree(double deadRatio = DEFAULT_DEAD_RATIO);
+    RBLazyTree(double deadRatio, const Compare& comp);
+    RBLazyTree(const RBLazyTree<T, Compare>& other);
+
+    RBLazyTree<T, Compare>& operator= (const RBLazyTree<T, Compare>& other);
+
+    bool contains(const T& key);
+    bool insert(const T& key);
+    bool remove(const T& key);
+    unsigned int count(const T& key);
+    iterator find(const T& key);
+    void clear();
+
+    //Removes all dead nodes and rebuilds the tree in O(n)
+    void compact();
+
+    //Incremental compaction that visits at most budget nodes per call in key
+    //order and removes the dead ones. Returns true when all nodes have been
+    //visited once, e.g. to spread the compaction over idle time.
+    bool compact_step(size_t budget);
+
+    inline bool empty() const { return live == 0; }
+    inline size_t size() const { return live; }
+    inline size_t dead() const { return deadCount; }
+
+    //Memory of a single node in bytes, dead nodes are kept until a compaction
+    static inline size_t nodeSize() { return Tree::nodeSize(); }
+
+    #ifdef DEBUG
+    bool invariant();
+    #endif
+
+    //Forward iterator over the live keys
+    class iterator {
+        private:
+            typename Tree::iterator node;
+
+            inline void skipDead() {
+                while (node != typename Tree::iterator(NULL) && node->dead) ++node;
+            }
+
+        public:
+            typedef T value_type;
+            typedef const T& reference;
+            typedef const T* pointer;
+            typedef std::ptrdiff_t difference_type;
+            typedef std::forward_iterator_tag iterator_category;
+
+            explicit iterator(typename Tree::iterator _node) : node(_node) { skipDead(); }
+
+            inline iterator& operator++ () {
+                ++node;
+                skipDead();
+                return *this;
+            }
+
+            inline iterator operator++ (int) {
+                iterator it = *this;
+                ++(*this);
+                return it;
+            }
+
+            inline bool operator== (const iterator& other) { return node == other.node; }
+            inline bool operator!= (const iterator& other) { return !(*this == other); }
+
+            inline reference operator* () { return node->key; }
+            inline pointer operator-> () { return &node->key; }
+    };
+
+    inline iterator begin() { return iterator(tree.begin()); }
+    inline iterator end() { return iterator(tree.end()); }
+};
+
+template <typename T, typename Compare>
+constexpr double RBLazyTree<T, Compare>::DEFAULT_DEAD_RATIO;
+
+template <typename T, typename Compare>
+RBLazyTree<T, Compare>::RBLazyTree(double deadRatio)
+    : RBLazyTree(deadRatio, Compare()) {}
+
+template <typename T, typename Compare>
+RBLazyTree<T, Compare>::RBLazyTree(double deadRatio, const Compare& comp)
+    : tree(EntryLess(comp)), live(0), deadCount(0), deadRatio(deadRatio), cursor(tree.end()) {}
+
+template <typename T, typename Compare>
+RBLazyTree<T, Compare>::RBLazyTree(const RBLazyTree<T, Compare>& other)
+    : tree(other.tree), live(other.live), deadCount(other.deadCount), deadRatio(other.deadRatio),
+      cursor(tree.end()) {
+    //The cursor belongs to the other tree, the copy restarts the compaction
+}
+
+template <typename T, typename Compare>
+RBLazyTree<T, Compare>& RBLazyTree<T, Compare>::operator= (const RBLazyTree<T, Compare>& other) {
+    if (this != &other) {
+        tree = other.tree;
+        live = other.live;
+        deadCount = other.deadCount;
+        deadRatio = other.deadRatio;
+        cursor = tree.end();
+    }
+
+    return *this;
+}
+
+template <typename T, typename Compare>
+typename RBLazyTree<T, Compare>::iterator RBLazyTree<T, Compare>::find(const T& key) {
+    typename Tree::iterator node = tree.find(key);
+    return (node != tree.end() && !node->dead) ? iterator(node) : end();
+}
+
+template <typename T, typename Compare>
+bool RBLazyTree<T, Compare>::contains(const T& key) {
+    typename Tree::iterator node = tree.find(key);
+    return node != tree.end() && !node->dead;
+}
+
+template <typename T, typename Compare>
+unsigned int RBLazyTree<T, Compare>::count(const T& key) {
+    return contains(key) ? 1 : 0;
+}
+
+template <typename T, typename Compare>
+bool RBLazyTree<T, Compare>::insert(const T& key) {
+    //Without dead nodes a key can only be new or live
+    if (deadCount > 0) {
+        typename Tree::iterator node = tree.find(key);
+
+        if (node != tree.end()) {
+            if (!node->dead) {
+                return false;
+            }
+
+            node->dead = false;
+            deadCount--;
+            live++;
+            autoStep();
+            return true;
+        }
+    }
+
+    if (!tree.insert(Entry(key))) {
+        return false;
+    }
+
+    live++;
+    autoStep();
+    return true;
+}
+
+template <typename T, typename Compare>
+bool RBLazyTree<T, Compare>::remove(const T& key) {
+    typename Tree::iterator node = tree.find(key);
+
+    if (node == tree.end() || node->dead) {
+        return false;
+    }
+
+    node->dead = true;
+    deadCount++;
+    live--;
+
+    //The compaction is spread over the following inserts, so a single call
+    //never rebuilds the tree. A pass visits all nodes in n / AUTO_STEP calls.
+    size_t nodes = live + deadCount;
+
+    if (cursor == tree.end() && deadCount > deadRatio * nodes) {
+        cursor = tree.begin();
+    }
+
+    //Without enough inserts the removes bound the dead nodes themselves
+    if (deadCount > (1 + deadRatio) / 2 * nodes) {
+        autoStep();
+    }
+
+    return true;
+}
+
+template <typename T, typename Compare>
+void RBLazyTree<T, Compare>::compact() {
+    if (deadCount > 0) {
+        tree.erase_if([](const Entry& entry) { return entry.dead; });
+        deadCount = 0;
+    }
+
+    cursor = tree.end();
+}
+
+template <typename T, typename Compare>
+bool RBLazyTree<T, Compare>::compact_step(size_t budget) {
+    if (cursor == tree.end()) {
+        cursor = tree.begin();
+    }
+
+    for (size_t i = 0; i < budget && cursor != tree.end(); i++) {
+        typename Tree::iterator node = cursor++;
+
+        //A single removal rebalances locally, the other nodes are not moved
+        if (node->dead) {
+            tree.extract(node);
+            deadCount--;
+        }
+    }
+
+    return cursor == tree.end();
+}
+
+template <typename T, typename Compare>
+void RBLazyTree<T, Compare>::clear() {
+    tree.clear();
+    live = 0;
+    deadCount = 0;
+    cursor = tree.end();
+}
+
+#ifdef DEBUG
+template <typename T, typename Compare>
+bool RBLazyTree<T, Compare>::invariant() {
+    size_t liveNodes = 0;
+    size_t deadNodes = 0;
+
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+        if (it->dead) {
+            deadNodes++;
+        } else {
+            liveNodes++;
+        }
+    }
+
+    return liveNodes == live && deadNodes == deadCount && tree.invariant();
+}
+#endif
+
+#endif /* RBTREE_LAZY_H */
@@ -0,0 +1,181 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+#ifndef RBTREE_MERGE_H
+#define RBTREE_MERGE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "rbtree.h"
+
+//Ordered iteration over the keys of several trees of the same type, e.g.
+//trees partitioned by tenant or by time. Every tree has an in-order cursor,
+//the cursors are ordered by a loser tree, so the next key is found with one
+//comparison per level (log N for N trees). Equal keys of different trees are
+//returned in the order of the trees, or only once when unique is set.
+//The trees must not be modified while they are iterated.
+template<typename Tree>
+class RBMergeIterator {
+public:
+    typedef typename Tree::value_type value_type;
+    typedef typename Tree::key_compare key_compare;
+
+private:
+    typedef typename Tree::iterator Cursor;
+
+    std::vector<Tree*> trees;
+    std::vector<Cursor> cursors;
+
+    //Loser tree over the cursors, losers[0] holds the overall winner and
+    //losers[i] the loser of the match at inner node i. The leaf of cursor c
+    //is the virtual node c + N.
+    std::vector<size_t> losers;
+    key_compare comp;
+    bool unique;
+
+    inline bool exhausted(size_t cursor) { return cursors[cursor] == trees[cursor]->end(); }
+    inline bool wins(size_t a, size_t b);
+    void replay(size_t cursor);
+    void rebuild();
+    void advance();
+
+public:
+    explicit RBMergeIterator(const std::vector<Tree*>& trees, bool unique = false);
+    RBMergeIterator(const std::vector<Tree*>& trees, bool unique, const key_compare& comp);
+
+    //Positions every cursor at the first key not less than key in O(N log n)
+    void seek(const value_type& key);
+
+    //Back to the smallest key of all trees
+    void rewind();
+
+    RBMergeIterator<Tree>& operator++ ();
+
+    //False when all keys have been returned
+    inline explicit operator bool() { return !trees.empty() && !exhausted(losers[0]); }
+
+    inline const value_type& operator* () { return *cursors[losers[0]]; }
+    inline const value_type* operator-> () { return &*cursors[losers[0]]; }
+
+    //Index of the tree of the current key
+    inline size_t source() const { return losers[0]; }
+};
+
+template <typename Tree>
+RBMergeIterator<Tree>::RBMergeIterator(const std::vector<Tree*>& trees, bool unique)
+    : RBMergeIterator(trees, unique, trees.empty() ? key_compare() : trees[0]->key_comp()) {}
+
+template <typename Tree>
+RBMergeIterator<Tree>::RBMergeIterator(const std::vector<Tree*>& trees, bool unique, const key_compare& comp)
+    : trees(trees), losers(trees.size()), comp(comp), unique(unique) {
+    rewind();
+}
+
+template <typename Tree>
+inline bool RBMergeIterator<Tree>::wins(size_t a, size_t b) {
+    //Exhausted cursors lose against all others, ties go to the first tree
+    if (exhausted(a)) return false;
+    if (exhausted(b)) return true;
+
+    const value_type& keyA = *cursors[a];
+    const value_type& keyB = *cursors[b];
+
+    if (comp(keyA, keyB)) return true;
+    if (comp(keyB, keyA)) return false;
+    return a < b;
+}
+
+template <typename Tree>
+void RBMergeIterator<Tree>::replay(size_t cursor) {
+    //Only the matches on the path of the changed cursor have to be replayed,
+    //the winner of each match moves up and the loser stays
+    size_t winner = cursor;
+
+    for (size_t node = (cursor + trees.size()) / 2; node > 0; node /= 2) {
+        if (wins(losers[node], winner)) {
+            std::swap(losers[node], winner);
+        }
+    }
+
+    losers[0] = winner;
+}
+
+template <typename Tree>
+void RBMergeIterator<Tree>::rebuild() {
+    //Bottom-up tournament, winners[i] is the winner below inner node i
+    size_t count = trees.size();
+
+    if (count == 0) {
+        return;
+    }
+
+    std::vector<size_t> winners(count);
+
+    for (size_t node = count - 1; node > 0; node--) {
+        size_t left = 2 * node;
+        size_t right = 2 * node + 1;
+        size_t a = (left >= count) ? left - count : winners[left];
+        size_t b = (right >= count) ? right - count : winners[right];
+
+        if (wins(a, b)) {
+            winners[node] = a;
+            losers[node] = b;
+        } else {
+            winners[node] = b;
+            losers[node] = a;
+        }
+    }
+
+    losers[0] = (count == 1) ? 0 : winners[1];
+}
+
+template <typename Tree>
+void RBMergeIterator<Tree>::advance() {
+    size_t winner = losers[0];
+    ++cursors[winner];
+    replay(winner);
+}
+
+template <typename Tree>
+void RBMergeIterator<Tree>::seek(const value_type& key) {
+    for (size_t i = 0; i < trees.size(); i++) {
+        cursors[i] = trees[i]->lower_bound(key);
+    }
+
+    rebuild();
+}
+
+template <typename Tree>
+void RBMergeIterator<Tree>::rewind() {
+    cursors.clear();
+
+    for (size_t i = 0; i < trees.size(); i++) {
+        cursors.push_back(trees[i]->begin());
+    }
+
+    rebuild();
+}
+
+template <typename Tree>
+RBMergeIterator<Tree>& RBMergeIterator<Tree>::operator++ () {
+    if (!unique) {
+        advance();
+        return *this;
+    }
+
+    //The keys stay in their nodes, so the returned key can be compared
+    //with the next ones without a copy
+    const value_type* last = &**this;
+    advance();
+
+    while (*this && !comp(*last, **this)) {
+        advance();
+    }
+
+    return *this;
+}
+
+#endif /* RBTREE_MERGE_H */
@@ -0,0 +1,238 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+#ifndef RBTREE_MERKLE_H
+#define RBTREE_MERKLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "rbtree.h"
+
+//Hash and number of the keys of a subtree or a key range. The key hashes
+//are summed up, so the hash of a key set does not depend on the shape of
+//the tree. Replicas with the same keys have the same hashes for every key
+//range, although their trees were built in a different order.
+struct RBMerkleHash {
+    uint64_t hash;
+    size_t count;
+
+    RBMerkleHash() : hash(0), count(0) {}
+    RBMerkleHash(uint64_t hash, size_t count) : hash(hash), count(count) {}
+
+    inline RBMerkleHash operator+ (const RBMerkleHash& other) const {
+        return RBMerkleHash(hash + other.hash, count + other.count);
+    }
+
+    inline RBMerkleHash operator- (const RBMerkleHash& other) const {
+        return RBMerkleHash(hash - other.hash, count - other.count);
+    }
+
+    inline bool operator== (const RBMerkleHash& other) const {
+        return hash == other.hash && count == other.count;
+    }
+
+    inline bool operator!= (const RBMerkleHash& other) const { return !(*this == other); }
+};
+
+template<typename T, typename Hash = std::hash<T>>
+struct RBMerkleAugment {
+    typedef RBMerkleHash value_type;
+
+    static inline RBMerkleHash of(const T& key, unsigned int count) {
+        //Finalizer of MurmurHash3, so that sums of similar keys differ
+        uint64_t hash = Hash()(key);
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return RBMerkleHash(hash * count, count);
+    }
+
+    static inline RBMerkleHash combine(const RBMerkleHash& a, const RBMerkleHash& b) { return a + b; }
+};
+
+//Tree where every node knows the hash of its subtree
+template<typename T, typename Compare = std::less<T>, typename Hash = std::hash<T>>
+using RBMerkleTree = RBTree<T, Compare, false, false, RBMerkleAugment<T, Hash>>;
+
+//Hash summary of a tree that can be sent to a replica. hashes[i] covers the
+//keys in [bounds[i - 1], bounds[i]), the first and the last range are open.
+template<typename T>
+struct RBMerkleSummary {
+    std::vector<T> bounds;
+    std::vector<RBMerkleHash> hashes;
+};
+
+//Hash of all keys lower than the key (or equal to it when inclusive),
+//a missing key stands for the whole tree
+template<typename T, typename Compare, typename Hash>
+RBMerkleHash merkle_hash_below(RBMerkleTree<T, Compare, Hash>& tree, const T* key, bool inclusive) {
+    typename RBMerkleTree<T, Compare, Hash>::node_view node = tree.root_view();
+    Compare comp = tree.key_comp();
+    RBMerkleHash sum;
+
+    if (key == NULL) {
+        return node ? node.augment() : sum;
+    }
+
+    while (node) {
+        if (comp(node.key(), *key) || (inclusive && !comp(*key, node.key()))) {
+            if (node.left()) sum = sum + node.left().augment();
+            sum = sum + RBMerkleAugment<T, Hash>::of(node.key(), node.count());
+            node = node.right();
+        } else {
+            node = node.left();
+        }
+    }
+
+    return sum;
+}
+
+//Hash of the keys in [from, to) in O(log n)
+template<typename T, typename Compare, typename Hash>
+inline RBMerkleHash merkle_hash_range(RBMerkleTree<T, Compare, Hash>& tree, const T& from, const T& to) {
+    return merkle_hash_below(tree, &to, false) - merkle_hash_below(tree, &from, false);
+}
+
+//Calls fn(key, inFirst) for all keys of the tree in the open range (from, to),
+//a missing bound is unbounded
+template<typename T, typename Compare, typename Hash, typename Function>
+void merkleReport(RBMerkleTree<T, Compare, Hash>& tree, const T* from, const T* to, bool inFirst, Function& fn) {
+    Compare comp = tree.key_comp();
+    typename RBMerkleTree<T, Compare, Hash>::iterator it = (from == NULL) ? tree.begin() : tree.lower_bound(*from);
+
+    for (; it != tree.end() && (to == NULL || comp(*it, *to)); ++it) {
+        if (from == NULL || comp(*from, *it)) {
+            fn(*it, inFirst);
+        }
+    }
+}
+
+//Calls fn(key, inFirst) for every key that is only in one of the trees. Only
+//key ranges with different hashes are searched, so nearly identical trees are
+//compared in O(d log^2 n) for d differences instead of O(n).
+template<typename T, typename Compare, typename Hash, typename Function>
+void diff(RBMerkleTree<T, Compare, Hash>& first, RBMerkleTree<T, Compare, Hash>& second, Function fn) {
+    typedef typename RBMerkleTree<T, Compare, Hash>::node_view View;
+
+    //Subtree of the first tree with the open key range it covers, or a single
+    //node of the first tree. The stack yields the keys in ascending order.
+    struct Task {
+        View node;
+        const T* from;
+        const T* to;
+        bool single;
+    };
+
+    std::vector<Task> tasks(1, Task{first.root_view(), NULL, NULL, false});
+
+    while (!tasks.empty()) {
+        Task task = tasks.back();
+        tasks.pop_back();
+
+        if (task.single) {
+            if (!second.contains(task.node.key())) {
+                fn(task.node.key(), true);
+            }
+
+            continue;
+        }
+
+        RBMerkleHash own = task.node ? task.node.augment() : RBMerkleHash();
+        RBMerkleHash other = merkle_hash_below(second, task.to, false) -
+                             ((task.from == NULL) ? RBMerkleHash() : merkle_hash_below(second, task.from, true));
+
+        if (own == other) {
+            continue;
+        }
+
+        //A range that is empty in one of the trees is reported as a whole
+        if (!task.node) {
+            merkleReport(second, task.from, task.to, false, fn);
+            continue;
+        }
+
+        if (other.count == 0) {
+            merkleReport(first, task.from, task.to, true, fn);
+            continue;
+        }
+
+        tasks.push_back(Task{task.node.right(), &task.node.key(), task.to, false});
+        tasks.push_back(Task{task.node, NULL, NULL, true});
+        tasks.push_back(Task{task.node.left(), task.from, &task.node.key(), false});
+    }
+}
+
+//Summary over given bounds, e.g. the bounds of a summary of a replica
+template<typename T, typename Compare, typename Hash>
+RBMerkleSummary<T> merkle_summary(RBMerkleTree<T, Compare, Hash>& tree, const std::vector<T>& bounds) {
+    RBMerkleSummary<T> summary;
+    RBMerkleHash lower;
+
+    summary.bounds = bounds;
+
+    for (size_t i = 0; i < bounds.size(); i++) {
+        RBMerkleHash below = merkle_hash_below(tree, &bounds[i], false);
+        summary.hashes.push_back(below - lower);
+        lower = below;
+    }
+
+    summary.hashes.push_back(merkle_hash_below(tree, (const T*)NULL, false) - lower);
+    return summary;
+}
+
+//Summary with the keys of the top levels of the tree as bounds
+template<typename T, typename Compare, typename Hash>
+RBMerkleSummary<T> merkle_summary(RBMerkleTree<T, Compare, Hash>& tree, unsigned int levels) {
+    typedef typename RBMerkleTree<T, Compare, Hash>::node_view View;
+
+    //In-order walk that does not descend below the given depth
+    std::vector<std::pair<View, unsigned int>> path;
+    std::vector<T> bounds;
+    View node = tree.root_view();
+    unsigned int depth = 0;
+
+    while (true) {
+        while (node && depth < levels) {
+            path.push_back(std::make_pair(node, depth));
+            node = node.left();
+            depth++;
+        }
+
+        if (path.empty()) {
+            break;
+        }
+
+        node = path.back().first;
+        depth = path.back().second + 1;
+        path.pop_back();
+
+        bounds.push_back(node.key());
+        node = node.right();
+    }
+
+    return merkle_summary(tree, bounds);
+}
+
+//Indices of the ranges that differ between two summaries over the same bounds
+template<typename T>
+std::vector<size_t> diff(const RBMerkleSummary<T>& first, const RBMerkleSummary<T>& second) {
+    std::vector<size_t> ranges;
+
+    for (size_t i = 0; i < first.hashes.size() && i < second.hashes.size(); i++) {
+        if (first.hashes[i] != second.hashes[i]) {
+            ranges.push_back(i);
+        }
+    }
+
+    return ranges;
+}
+
+#endif /* RBTREE_MERKLE_H */
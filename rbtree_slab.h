@@ -0,0 +1,330 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+#ifndef RBTREE_SLAB_H
+#define RBTREE_SLAB_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "rbtree.h"
+
+//Storage for values in chunks of fixed size, a value is addressed by its
+//slot. The chunks are never moved, so a value stays at its address until
+//its slot is released. Released slots are reused first.
+template<typename V>
+class RBPayloadSlab {
+public:
+    //Values per chunk
+    static const uint32_t CHUNK_SIZE = 1024;
+
+private:
+    std::vector<V*> chunks;
+    std::vector<uint32_t> released;
+    uint32_t used;
+
+public:
+    RBPayloadSlab() : used(0) {}
+    RBPayloadSlab(const RBPayloadSlab<V>&) = delete;
+    ~RBPayloadSlab();
+
+    RBPayloadSlab<V>& operator= (const RBPayloadSlab<V>&) = delete;
+
+    template<typename... Args>
+    uint32_t create(Args&&... args);
+
+    //The value of the slot is destroyed, the slot may be returned by create again
+    void release(uint32_t slot);
+
+    //Frees the chunks, the values of all slots have to be released before
+    void reset();
+    void swap(RBPayloadSlab<V>& other);
+
+    inline V& operator[] (uint32_t slot) { return chunks[slot / CHUNK_SIZE][slot % CHUNK_SIZE]; }
+    inline const V& operator[] (uint32_t slot) const { return chunks[slot / CHUNK_SIZE][slot % CHUNK_SIZE]; }
+    inline size_t live() const { return used - released.size(); }
+};
+
+template <typename V>
+RBPayloadSlab<V>::~RBPayloadSlab() {
+    reset();
+}
+
+template <typename V>
+template <typename... Args>
+uint32_t RBPayloadSlab<V>::create(Args&&... args) {
+    uint32_t slot;
+
+    if (!released.empty()) {
+        slot = released.back();
+        new (&(*this)[slot]) V(std::forward<Args>(args)...);
+        released.pop_back();
+        return slot;
+    }
+
+    if (used == chunks.size() * CHUNK_SIZE) {
+        chunks.push_back(static_cast<V*>(::operator new(CHUNK_SIZE * sizeof(V))));
+    }
+
+    //The slot is only taken when the value was constructed
+    new (&(*this)[used]) V(std::forward<Args>(args)...);
+    return used++;
+}
+
+template <typename V>
+void RBPayloadSlab<V>::release(uint32_t slot) {
+    (*this)[slot].~V();
+    released.push_back(slot);
+}
+
+template <typename V>
+void RBPayloadSlab<V>::reset() {
+    for (size_t i = 0; i < chunks.size(); i++) {
+        ::operator delete(chunks[i]);
+    }
+
+    chunks.clear();
+    released.clear();
+    used = 0;
+}
+
+template <typename V>
+void RBPayloadSlab<V>::swap(RBPayloadSlab<V>& other) {
+    chunks.swap(other.chunks);
+    released.swap(other.released);
+    std::swap(used, other.used);
+}
+
+//Map with a hot/cold split layout. The tree nodes only hold the key and the
+//slot of the value, so searches and rebalancing stay within compact nodes
+//regardless of the size of the values. The values are stored in a slab and
+//are only touched when a value is accessed.
+template<typename K, typename V, typename Compare = std::less<K>>
+class RBSlabMap {
+private:
+    //Hot part of an entry, the slot is not part of the order
+    struct Entry {
+        K key;
+        mutable uint32_t slot;
+
+        Entry(const K& key, uint32_t slot) : key(key), slot(slot) {}
+    };
+
+    //Compares entries and keys, so a lookup needs no temporary entry
+    struct EntryLess {
+        typedef void is_transparent;
+        Compare comp;
+
+        explicit EntryLess(const Compare& comp) : comp(comp) {}
+
+        inline bool operator() (const Entry& a, const Entry& b) const { return comp(a.key, b.key); }
+        inline bool operator() (const Entry& a, const K& b) const { return comp(a.key, b); }
+        inline bool operator() (const K& a, const Entry& b) const { return comp(a, b.key); }
+    };
+
+    typedef RBTree<Entry, EntryLess> Tree;
+
+    Tree tree;
+    RBPayloadSlab<V> values;
+
+public:
+    class iterator;
+
+    RBSlabMap();
+    explicit RBSlabMap(const Compare& comp);
+    RBSlabMap(const RBSlabMap<K, V, Compare>& other);
+    ~RBSlabMap();
+
+    RBSlabMap<K, V, Compare>& operator= (const RBSlabMap<K, V, Compare>& other);
+
+    //Only the nodes are searched, the value is not touched
+    bool contains(const K& key);
+
+    //Returns NULL when the key is missing, the value stays at its address
+    //until the key is removed
+    V* find(const K& key);
+
+    //Returns false and keeps the old value when the key is already stored
+    bool insert(const K& key, const V& value);
+
+    //Inserts the key or replaces its value
+    void assign(const K& key, const V& value);
+
+    bool remove(const K& key);
+    void clear();
+
+    inline bool empty() const { return tree.empty(); }
+    inline size_t size() const { return values.live(); }
+
+    //Memory of a single node in bytes, without the value
+    static inline size_t nodeSize() { return Tree::nodeSize(); }
+
+    #ifdef DEBUG
+    bool invariant();
+    #endif
+
+    //Iterates the entries in key order
+    class iterator {
+        private:
+            typename Tree::iterator node;
+            RBPayloadSlab<V>* values;
+
+        public:
+            iterator(typename Tree::iterator _node, RBPayloadSlab<V>* _values) : node(_node), values(_values) {}
+
+            inline iterator& operator++ () {
+                ++node;
+                return *this;
+            }
+
+            inline bool operator== (const iterator& other) { return node == other.node; }
+            inline bool operator!= (const iterator& other) { return !(*this == other); }
+
+            inline const K& key() { return node->key; }
+            inline V& value() { return (*values)[node->slot]; }
+    };
+
+    inline iterator begin() { return iterator(tree.begin(), &values); }
+    inline iterator end() { return iterator(tree.end(), &values); }
+};
+
+template <typename K, typename V, typename Compare>
+RBSlabMap<K, V, Compare>::RBSlabMap()
+    : tree(EntryLess(Compare())) {}
+
+template <typename K, typename V, typename Compare>
+RBSlabMap<K, V, Compare>::RBSlabMap(const Compare& comp)
+    : tree(EntryLess(comp)) {}
+
+template <typename K, typename V, typename Compare>
+RBSlabMap<K, V, Compare>::RBSlabMap(const RBSlabMap<K, V, Compare>& other)
+    : tree(other.tree) {
+    //The copied nodes refer to the slots of the other map until their values
+    //are copied into the own slab
+    typename Tree::iterator it = tree.begin();
+
+    try {
+        for (; it != tree.end(); ++it) {
+            it->slot = values.create(other.values[it->slot]);
+        }
+    } catch (...) {
+        for (typename Tree::iterator copied = tree.begin(); copied != it; ++copied) {
+            values.release(copied->slot);
+        }
+
+        throw;
+    }
+}
+
+template <typename K, typename V, typename Compare>
+RBSlabMap<K, V, Compare>::~RBSlabMap() {
+    clear();
+}
+
+template <typename K, typename V, typename Compare>
+RBSlabMap<K, V, Compare>& RBSlabMap<K, V, Compare>::operator= (const RBSlabMap<K, V, Compare>& other) {
+    if (this != &other) {
+        RBSlabMap<K, V, Compare> copy(other);
+        tree.swap(copy.tree);
+        values.swap(copy.values);
+    }
+
+    return *this;
+}
+
+template <typename K, typename V, typename Compare>
+bool RBSlabMap<K, V, Compare>::contains(const K& key) {
+    return tree.contains(key);
+}
+
+template <typename K, typename V, typename Compare>
+V* RBSlabMap<K, V, Compare>::find(const K& key) {
+    typename Tree::iterator node = tree.find(key);
+    return (node == tree.end()) ? NULL : &values[node->slot];
+}
+
+template <typename K, typename V, typename Compare>
+bool RBSlabMap<K, V, Compare>::insert(const K& key, const V& value) {
+    //A duplicate is found among the hot nodes, so it never writes a value
+    if (tree.contains(key)) {
+        return false;
+    }
+
+    uint32_t slot = values.create(value);
+
+    try {
+        tree.insert(Entry(key, slot));
+    } catch (...) {
+        values.release(slot);
+        throw;
+    }
+
+    return true;
+}
+
+template <typename K, typename V, typename Compare>
+void RBSlabMap<K, V, Compare>::assign(const K& key, const V& value) {
+    V* stored = find(key);
+
+    if (stored != NULL) {
+        *stored = value;
+    } else {
+        insert(key, value);
+    }
+}
+
+template <typename K, typename V, typename Compare>
+bool RBSlabMap<K, V, Compare>::remove(const K& key) {
+    typename Tree::iterator node = tree.find(key);
+
+    if (node == tree.end()) {
+        return false;
+    }
+
+    //The slot is read before the node is released with the handle
+    uint32_t slot = node->slot;
+    tree.extract(node);
+    values.release(slot);
+    return true;
+}
+
+template <typename K, typename V, typename Compare>
+void RBSlabMap<K, V, Compare>::clear() {
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+        values[it->slot].~V();
+    }
+
+    tree.clear();
+    values.reset();
+}
+
+#ifdef DEBUG
+template <typename K, typename V, typename Compare>
+bool RBSlabMap<K, V, Compare>::invariant() {
+    //Every live slot belongs to exactly one node
+    std::vector<bool> seen;
+    size_t nodes = 0;
+
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it, nodes++) {
+        if (it->slot >= seen.size()) {
+            seen.resize(it->slot + 1, false);
+        }
+
+        if (seen[it->slot]) {
+            return false;
+        }
+
+        seen[it->slot] = true;
+    }
+
+    return nodes == values.live() && tree.invariant();
+}
+#endif
+
+#endif /* RBTREE_SLAB_H */
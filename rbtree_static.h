@@ -0,0 +1,370 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+#ifndef RBTREE_STATIC_H
+#define RBTREE_STATIC_H
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <stdexcept>
+
+//Red-black tree with a fixed capacity for key sets that are known at compile
+//time, e.g. opcodes or reserved keywords. The nodes are stored in an array and
+//linked by their indices, so the tree can be built and searched in constant
+//expressions. A constexpr tree is placed in read-only data and needs no setup
+//at runtime. The key type and the comparator have to be literal types.
+template<typename T, size_t N, typename Compare = std::less<T>>
+class RBStaticTree {
+private:
+    //Index of a missing node
+    static constexpr int NIL = -1;
+
+    struct Node {
+        T key;
+        int parent;
+        int left;
+        int right;
+        bool red;
+
+        constexpr Node() : key(), parent(NIL), left(NIL), right(NIL), red(false) {}
+    };
+
+    //The nodes are stored in the order of their insertion
+    Node nodes[(N == 0) ? 1 : N];
+    int root;
+    size_t used;
+    Compare comp;
+
+    constexpr void leftRotate(int node);
+    constexpr void rightRotate(int node);
+    constexpr void adjustInsert(int node);
+    constexpr int minimum(int node) const;
+    constexpr int successor(int node) const;
+    constexpr int lookup(const T& key) const;
+
+    #ifdef DEBUG
+    constexpr int invariantBlackNodes(int node) const;
+    #endif
+
+public:
+    class iterator;
+
+    constexpr explicit RBStaticTree(const Compare& comp = Compare());
+    constexpr RBStaticTree(std::initializer_list<T> keys, const Compare& comp = Compare());
+
+    //Returns false for a stored key. More than N keys are an error, which
+    //fails the compilation when the tree is built at compile time.
+    constexpr bool insert(const T& key);
+
+    constexpr bool contains(const T& key) const { return lookup(key) != NIL; }
+    constexpr unsigned int count(const T& key) const { return contains(key) ? 1 : 0; }
+
+    //Returns NULL for a missing key
+    constexpr const T* find(const T& key) const;
+
+    constexpr bool empty() const { return used == 0; }
+    constexpr size_t size() const { return used; }
+    static constexpr size_t capacity() { return N; }
+
+    #ifdef DEBUG
+    constexpr bool invariant() const;
+    #endif
+
+    //Iterates the keys in order
+    class iterator {
+        private:
+            const RBStaticTree<T, N, Compare>* tree;
+            int node;
+
+        public:
+            constexpr iterator(const RBStaticTree<T, N, Compare>* _tree, int _node) : tree(_tree), node(_node) {}
+
+            constexpr iterator& operator++ () {
+                node = tree->successor(node);
+                return *this;
+            }
+
+            constexpr bool operator== (const iterator& other) const { return node == other.node; }
+            constexpr bool operator!= (const iterator& other) const { return !(*this == other); }
+
+            constexpr const T& operator* () const { return tree->nodes[node].key; }
+            constexpr const T* operator-> () const { return &tree->nodes[node].key; }
+    };
+
+    constexpr iterator begin() const { return iterator(this, minimum(root)); }
+    constexpr iterator end() const { return iterator(this, NIL); }
+};
+
+//Tree with exactly the capacity for the given keys, e.g.
+//constexpr auto opcodes = make_static_tree<int>(0x01, 0x02, 0x10);
+template<typename T, typename... Keys>
+constexpr RBStaticTree<T, sizeof...(Keys)> make_static_tree(const Keys&... keys) {
+    return RBStaticTree<T, sizeof...(Keys)>({T(keys)...});
+}
+
+template <typename T, size_t N, typename Compare>
+constexpr int RBStaticTree<T, N, Compare>::NIL;
+
+template <typename T, size_t N, typename Compare>
+constexpr RBStaticTree<T, N, Compare>::RBStaticTree(const Compare& comp)
+    : nodes(), root(NIL), used(0), comp(comp) {}
+
+template <typename T, size_t N, typename Compare>
+constexpr RBStaticTree<T, N, Compare>::RBStaticTree(std::initializer_list<T> keys, const Compare& comp)
+    : nodes(), root(NIL), used(0), comp(comp) {
+    for (const T* key = keys.begin(); key != keys.end(); key++) {
+        insert(*key);
+    }
+}
+
+template <typename T, size_t N, typename Compare>
+constexpr void RBStaticTree<T, N, Compare>::leftRotate(int node) {
+    int child = nodes[node].right;
+    int parent = nodes[node].parent;
+
+    nodes[node].right = nodes[child].left;
+
+    if (nodes[child].left != NIL) {
+        nodes[nodes[child].left].parent = node;
+    }
+
+    nodes[child].parent = parent;
+
+    if (parent == NIL) {
+        root = child;
+    } else if (nodes[parent].left == node) {
+        nodes[parent].left = child;
+    } else {
+        nodes[parent].right = child;
+    }
+
+    nodes[child].left = node;
+    nodes[node].parent = child;
+}
+
+template <typename T, size_t N, typename Compare>
+constexpr void RBStaticTree<T, N, Compare>::rightRotate(int node) {
+    int child = nodes[node].left;
+    int parent = nodes[node].parent;
+
+    nodes[node].left = nodes[child].right;
+
+    if (nodes[child].right != NIL) {
+        nodes[nodes[child].right].parent = node;
+    }
+
+    nodes[child].parent = parent;
+
+    if (parent == NIL) {
+        root = child;
+    } else if (nodes[parent].left == node) {
+        nodes[parent].left = child;
+    } else {
+        nodes[parent].right = child;
+    }
+
+    nodes[child].right = node;
+    nodes[node].parent = child;
+}
+
+template <typename T, size_t N, typename Compare>
+constexpr void RBStaticTree<T, N, Compare>::adjustInsert(int node) {
+    //A red parent is never the root, so the grandparent exists
+    while (node != root && nodes[nodes[node].parent].red) {
+        int parent = nodes[node].parent;
+        int grandparent = nodes[parent].parent;
+
+        if (parent == nodes[grandparent].left) {
+            int uncle = nodes[grandparent].right;
+
+            if (uncle != NIL && nodes[uncle].red) {
+                nodes[parent].red = false;
+                nodes[uncle].red = false;
+                nodes[grandparent].red = true;
+                node = grandparent;
+                continue;
+            }
+
+            if (node == nodes[parent].right) {
+                leftRotate(parent);
+                parent = node;
+            }
+
+            nodes[parent].red = false;
+            nodes[grandparent].red = true;
+            rightRotate(grandparent);
+        } else {
+            int uncle = nodes[grandparent].left;
+
+            if (uncle != NIL && nodes[uncle].red) {
+                nodes[parent].red = false;
+                nodes[uncle].red = false;
+                nodes[grandparent].red = true;
+                node = grandparent;
+                continue;
+            }
+
+            if (node == nodes[parent].left) {
+                rightRotate(parent);
+                parent = node;
+            }
+
+            nodes[parent].red = false;
+            nodes[grandparent].red = true;
+            leftRotate(grandparent);
+        }
+    }
+
+    nodes[root].red = false;
+}
+
+template <typename T, size_t N, typename Compare>
+constexpr bool RBStaticTree<T, N, Compare>::insert(const T& key) {
+    int parent = NIL;
+    int node = root;
+    bool left = false;
+
+    while (node != NIL) {
+        parent = node;
+
+        if (comp(key, nodes[node].key)) {
+            node = nodes[node].left;
+            left = true;
+        } else if (comp(nodes[node].key, key)) {
+            node = nodes[node].right;
+            left = false;
+        } else {
+            return false;
+        }
+    }
+
+    if (used == N) {
+        throw std::length_error("RBStaticTree capacity exceeded");
+    }
+
+    int created = (int)used++;
+    nodes[created].key = key;
+    nodes[created].parent = parent;
+    nodes[created].red = true;
+
+    if (parent == NIL) {
+        root = created;
+    } else if (left) {
+        nodes[parent].left = created;
+    } else {
+        nodes[parent].right = created;
+    }
+
+    adjustInsert(created);
+    return true;
+}
+
+template <typename T, size_t N, typename Compare>
+constexpr int RBStaticTree<T, N, Compare>::lookup(const T& key) const {
+    int node = root;
+
+    while (node != NIL) {
+        if (comp(key, nodes[node].key)) {
+            node = nodes[node].left;
+        } else if (comp(nodes[node].key, key)) {
+            node = nodes[node].right;
+        } else {
+            break;
+        }
+    }
+
+    return node;
+}
+
+template <typename T, size_t N, typename Compare>
+constexpr const T* RBStaticTree<T, N, Compare>::find(const T& key) const {
+    int node = lookup(key);
+    return (node == NIL) ? NULL : &nodes[node].key;
+}
+
+template <typename T, size_t N, typename Compare>
+constexpr int RBStaticTree<T, N, Compare>::minimum(int node) const {
+    while (node != NIL && nodes[node].left != NIL) {
+        node = nodes[node].left;
+    }
+
+    return node;
+}
+
+template <typename T, size_t N, typename Compare>
+constexpr int RBStaticTree<T, N, Compare>::successor(int node) const {
+    if (nodes[node].right != NIL) {
+        return minimum(nodes[node].right);
+    }
+
+    //Ascend until the node is in a left subtree
+    int parent = nodes[node].parent;
+
+    while (parent != NIL && node == nodes[parent].right) {
+        node = parent;
+        parent = nodes[parent].parent;
+    }
+
+    return parent;
+}
+
+#ifdef DEBUG
+template <typename T, size_t N, typename Compare>
+constexpr int RBStaticTree<T, N, Compare>::invariantBlackNodes(int node) const {
+    //Black nodes on every path below the node, -1 for a violation
+    if (node == NIL) {
+        return 1;
+    }
+
+    int left = nodes[node].left;
+    int right = nodes[node].right;
+
+    if ((left != NIL && nodes[left].parent != node) || (right != NIL && nodes[right].parent != node)) {
+        return -1;
+    }
+
+    if (nodes[node].red && ((left != NIL && nodes[left].red) || (right != NIL && nodes[right].red))) {
+        return -1;
+    }
+
+    int leftBlack = invariantBlackNodes(left);
+    int rightBlack = invariantBlackNodes(right);
+
+    if (leftBlack < 0 || leftBlack != rightBlack) {
+        return -1;
+    }
+
+    return leftBlack + (nodes[node].red ? 0 : 1);
+}
+
+template <typename T, size_t N, typename Compare>
+constexpr bool RBStaticTree<T, N, Compare>::invariant() const {
+    if (root != NIL && (nodes[root].red || nodes[root].parent != NIL)) {
+        return false;
+    }
+
+    if (invariantBlackNodes(root) < 0) {
+        return false;
+    }
+
+    //The keys are strictly ascending and every node is reached once
+    size_t visited = 0;
+
+    for (int node = minimum(root); node != NIL; node = successor(node)) {
+        int next = successor(node);
+
+        if (next != NIL && !comp(nodes[node].key, nodes[next].key)) {
+            return false;
+        }
+
+        visited++;
+    }
+
+    return visited == used;
+}
+#endif
+
+#endif /* RBTREE_STATIC_H */
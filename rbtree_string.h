@@ -0,0 +1,204 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+#ifndef RBTREE_STRING_H
+#define RBTREE_STRING_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <string>
+
+#include "rbtree.h"
+
+//Compact string key for trees with many string keys. Short keys are stored
+//completely inside the key, so they need no heap buffer. Longer keys keep a
+//prefix inline next to a pointer to the remaining characters. Comparisons
+//resolve on the inline prefix without touching the heap whenever possible.
+class RBStringKey {
+public:
+    //Keys up to this length are stored inline
+    static const size_t INLINE_SIZE = 20;
+
+    //Inline prefix of longer keys, followed by the pointer to the tail
+    static const size_t PREFIX_SIZE = INLINE_SIZE - sizeof(char*);
+
+private:
+    uint32_t length;
+    char data[INLINE_SIZE];
+
+    inline bool isInline() const { return length <= INLINE_SIZE; }
+    inline char* tail() const;
+    inline void assign(const char* chars, size_t size);
+
+public:
+    RBStringKey() : length(0) {}
+    RBStringKey(const char* chars) { assign(chars, strlen(chars)); }
+    RBStringKey(const char* chars, size_t size) { assign(chars, size); }
+    RBStringKey(const std::string& text) { assign(text.data(), text.size()); }
+    RBStringKey(const RBStringKey& other);
+    RBStringKey(RBStringKey&& other);
+    ~RBStringKey();
+
+    RBStringKey& operator= (const RBStringKey& other);
+    RBStringKey& operator= (RBStringKey&& other);
+
+    inline size_t size() const { return length; }
+    std::string str() const;
+
+    //Three-way comparison of two character sequences given as the inline
+    //prefix and the characters after the prefix
+    static inline int compare(const char* head, const char* rest, size_t size,
+                              const char* otherHead, const char* otherRest, size_t otherSize);
+
+    inline int compare(const RBStringKey& other) const;
+    inline int compare(const char* chars, size_t size) const;
+
+    inline bool operator< (const RBStringKey& other) const { return compare(other) < 0; }
+    inline bool operator== (const RBStringKey& other) const { return compare(other) == 0; }
+    inline bool operator!= (const RBStringKey& other) const { return compare(other) != 0; }
+};
+
+//Transparent comparator, trees can be searched with std::string and
+//const char* without constructing a key
+struct RBStringKeyLess {
+    typedef void is_transparent;
+
+    inline bool operator() (const RBStringKey& a, const RBStringKey& b) const { return a.compare(b) < 0; }
+
+    inline bool operator() (const RBStringKey& a, const std::string& b) const {
+        return a.compare(b.data(), b.size()) < 0;
+    }
+
+    inline bool operator() (const std::string& a, const RBStringKey& b) const {
+        return b.compare(a.data(), a.size()) > 0;
+    }
+
+    inline bool operator() (const RBStringKey& a, const char* b) const {
+        return a.compare(b, strlen(b)) < 0;
+    }
+
+    inline bool operator() (const char* a, const RBStringKey& b) const {
+        return b.compare(a, strlen(a)) > 0;
+    }
+};
+
+template<typename Compare = RBStringKeyLess>
+using RBStringTree = RBTree<RBStringKey, Compare>;
+
+inline char* RBStringKey::tail() const {
+    //The tail pointer of a long key follows the prefix
+    char* pointer;
+    memcpy(&pointer, data + PREFIX_SIZE, sizeof(pointer));
+    return pointer;
+}
+
+inline void RBStringKey::assign(const char* chars, size_t size) {
+    length = (uint32_t)size;
+
+    if (isInline()) {
+        memcpy(data, chars, size);
+        return;
+    }
+
+    char* rest = new char[size - PREFIX_SIZE];
+    memcpy(rest, chars + PREFIX_SIZE, size - PREFIX_SIZE);
+    memcpy(data, chars, PREFIX_SIZE);
+    memcpy(data + PREFIX_SIZE, &rest, sizeof(rest));
+}
+
+inline RBStringKey::RBStringKey(const RBStringKey& other) {
+    length = other.length;
+    memcpy(data, other.data, INLINE_SIZE);
+
+    //Long keys get their own tail
+    if (!isInline()) {
+        char* rest = new char[length - PREFIX_SIZE];
+        memcpy(rest, other.tail(), length - PREFIX_SIZE);
+        memcpy(data + PREFIX_SIZE, &rest, sizeof(rest));
+    }
+}
+
+inline RBStringKey::RBStringKey(RBStringKey&& other) {
+    //The tail moves with the pointer, the other key becomes empty
+    length = other.length;
+    memcpy(data, other.data, INLINE_SIZE);
+    other.length = 0;
+}
+
+inline RBStringKey::~RBStringKey() {
+    if (!isInline()) {
+        delete[] tail();
+    }
+}
+
+inline RBStringKey& RBStringKey::operator= (const RBStringKey& other) {
+    if (this != &other) {
+        RBStringKey copy(other);
+        *this = std::move(copy);
+    }
+
+    return *this;
+}
+
+inline RBStringKey& RBStringKey::operator= (RBStringKey&& other) {
+    if (this != &other) {
+        if (!isInline()) {
+            delete[] tail();
+        }
+
+        length = other.length;
+        memcpy(data, other.data, INLINE_SIZE);
+        other.length = 0;
+    }
+
+    return *this;
+}
+
+inline std::string RBStringKey::str() const {
+    if (isInline()) {
+        return std::string(data, length);
+    }
+
+    std::string text(data, PREFIX_SIZE);
+    text.append(tail(), length - PREFIX_SIZE);
+    return text;
+}
+
+inline int RBStringKey::compare(const char* head, const char* rest, size_t size,
+                                const char* otherHead, const char* otherRest, size_t otherSize) {
+    size_t common = std::min(size, otherSize);
+    int result = memcmp(head, otherHead, (common < PREFIX_SIZE) ? common : PREFIX_SIZE);
+
+    //Only keys with an equal prefix have to look at the tails
+    if (result == 0 && common > PREFIX_SIZE) {
+        result = memcmp(rest, otherRest, common - PREFIX_SIZE);
+    }
+
+    if (result != 0) {
+        return result;
+    }
+
+    return (size < otherSize) ? -1 : (size > otherSize ? 1 : 0);
+}
+
+inline int RBStringKey::compare(const RBStringKey& other) const {
+    //Inline keys continue right after the prefix
+    return compare(data, isInline() ? data + PREFIX_SIZE : tail(), length,
+                   other.data, other.isInline() ? other.data + PREFIX_SIZE : other.tail(), other.length);
+}
+
+inline int RBStringKey::compare(const char* chars, size_t size) const {
+    return compare(data, isInline() ? data + PREFIX_SIZE : tail(), length,
+                   chars, (size > PREFIX_SIZE) ? chars + PREFIX_SIZE : chars, size);
+}
+
+inline std::ostream& operator<< (std::ostream& stream, const RBStringKey& key) {
+    return stream << key.str();
+}
+
+#endif /* RBTREE_STRING_H */
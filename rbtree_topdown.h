@@ -0,0 +1,475 @@
+// ---------------------------------------------------------------------
+// MIT License
+// Copyright (c) 2017 Henrik Peters
+// See LICENSE file in the project root for full license information.
+// ---------------------------------------------------------------------
+#ifndef RBTREE_TOPDOWN_H
+#define RBTREE_TOPDOWN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+//Red-black tree that restructures on the way down, so insert and remove
+//finish in a single root-to-leaf pass. The nodes only store the two child
+//links with the color in a spare bit, there is no parent link. This is a
+//separate type, not a balancing parameter of RBTree: it only shares the core
+//interface, so generic code can be written against either tree.
+template<typename T, typename Compare = std::less<T>>
+class RBTopDownTree {
+private:
+    struct Node;
+
+    //Links and color without a key, so the head above the root does not
+    //need a key either. The color is kept in the lowest bit of the left
+    //link, so a node is two pointers and the key without any padding.
+    struct Link {
+        uintptr_t links[2];
+
+        Link() {
+            links[0] = 0;
+            links[1] = 0;
+        }
+
+        inline Node* link(int dir) const { return reinterpret_cast<Node*>(links[dir] & ~(uintptr_t)1); }
+        inline void setLink(int dir, Node* node) { links[dir] = reinterpret_cast<uintptr_t>(node) | (links[dir] & 1); }
+        inline bool red() const { return (links[0] & 1) != 0; }
+        inline void setRed(bool red) { links[0] = (links[0] & ~(uintptr_t)1) | (red ? 1 : 0); }
+    };
+
+    struct Node : public Link {
+        T key;
+
+        explicit Node(const T& key) : key(key) {
+            this->setRed(true);
+        }
+    };
+
+    Node* root;
+    Compare comp;
+
+    static inline bool isRed(const Node* node) { return node != NULL && node->red(); }
+    static Node* rotate(Node* node, int dir);
+    static Node* rotateTwice(Node* node, int dir);
+    static void destroy(Node* node);
+
+    #ifdef DEBUG
+    int invariantBlackNodes(const Node* node);
+    #endif
+
+public:
+    RBTopDownTree();
+    explicit RBTopDownTree(const Compare& comp);
+    RBTopDownTree(const RBTopDownTree<T, Compare>&) = delete;
+    RBTopDownTree(RBTopDownTree<T, Compare>&& other);
+    virtual ~RBTopDownTree();
+
+    RBTopDownTree<T, Compare>& operator= (const RBTopDownTree<T, Compare>&) = delete;
+    RBTopDownTree<T, Compare>& operator= (RBTopDownTree<T, Compare>&& other);
+
+    bool contains(const T& key);
+    bool insert(const T& key);
+    //The key of the removed node is replaced by the key of its in-order
+    //neighbour, so T has to be move assignable
+    bool remove(const T& key);
+    unsigned int count(const T& key);
+    void clear();
+    inline bool empty() const { return root == NULL; }
+
+    //Memory of a single node in bytes
+    static inline size_t nodeSize() { return sizeof(Node); }
+
+    #ifdef DEBUG
+    bool invariant();
+    #endif
+
+    //Without parent links the iterator keeps the path from the root
+    class iterator {
+        private:
+            std::vector<Node*> path;
+            friend class RBTopDownTree<T, Compare>;
+
+            void descend(Node* node);
+
+        public:
+            typedef T value_type;
+            typedef const T& reference;
+            typedef const T* pointer;
+            typedef std::ptrdiff_t difference_type;
+            typedef std::forward_iterator_tag iterator_category;
+
+            iterator() {}
+
+            iterator& operator++ ();
+            inline iterator operator++ (int) {
+                iterator it = *this;
+                ++(*this);
+                return it;
+            }
+
+            inline bool operator== (const iterator& other) {
+                return (path.empty() && other.path.empty()) ||
+                       (!path.empty() && !other.path.empty() && path.back() == other.path.back());
+            }
+            inline bool operator!= (const iterator& other) { return !(*this == other); }
+
+            inline reference operator* () { return path.back()->key; }
+            inline pointer operator-> () { return &path.back()->key; }
+    };
+
+    iterator begin();
+    iterator end();
+    iterator find(const T& key);
+};
+
+template <typename T, typename Compare>
+RBTopDownTree<T, Compare>::RBTopDownTree() : comp() {
+    this->root = NULL;
+}
+
+template <typename T, typename Compare>
+RBTopDownTree<T, Compare>::RBTopDownTree(const Compare& comp) : comp(comp) {
+    this->root = NULL;
+}
+
+template <typename T, typename Compare>
+RBTopDownTree<T, Compare>::RBTopDownTree(RBTopDownTree<T, Compare>&& other) : comp(other.comp) {
+    this->root = other.root;
+    other.root = NULL;
+}
+
+template <typename T, typename Compare>
+RBTopDownTree<T, Compare>::~RBTopDownTree() {
+    destroy(root);
+}
+
+template <typename T, typename Compare>
+RBTopDownTree<T, Compare>& RBTopDownTree<T, Compare>::operator= (RBTopDownTree<T, Compare>&& other) {
+    std::swap(root, other.root);
+    std::swap(comp, other.comp);
+    return *this;
+}
+
+template <typename T, typename Compare>
+typename RBTopDownTree<T, Compare>::Node* RBTopDownTree<T, Compare>::rotate(Node* node, int dir) {
+    //Rotate the child on the other side up and recolor the old and new root
+    Node* child = node->link(!dir);
+
+    node->setLink(!dir, child->link(dir));
+    child->setLink(dir, node);
+
+    node->setRed(true);
+    child->setRed(false);
+    return child;
+}
+
+template <typename T, typename Compare>
+typename RBTopDownTree<T, Compare>::Node* RBTopDownTree<T, Compare>::rotateTwice(Node* node, int dir) {
+    node->setLink(!dir, rotate(node->link(!dir), !dir));
+    return rotate(node, dir);
+}
+
+template <typename T, typename Compare>
+void RBTopDownTree<T, Compare>::destroy(Node* node) {
+    //Free the nodes without recursion by rotating left childs up
+    while (node != NULL) {
+        if (node->link(0) != NULL) {
+            Node* left = node->link(0);
+            node->setLink(0, left->link(1));
+            left->setLink(1, node);
+            node = left;
+
+        } else {
+            Node* right = node->link(1);
+            delete node;
+            node = right;
+        }
+    }
+}
+
+template <typename T, typename Compare>
+bool RBTopDownTree<T, Compare>::contains(const T& key) {
+    Node* node = root;
+
+    while (node != NULL) {
+        if (comp(key, node->key)) {
+            node = node->link(0);
+        } else if (comp(node->key, key)) {
+            node = node->link(1);
+        } else {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template <typename T, typename Compare>
+unsigned int RBTopDownTree<T, Compare>::count(const T& key) {
+    return contains(key) ? 1 : 0;
+}
+
+template <typename T, typename Compare>
+bool RBTopDownTree<T, Compare>::insert(const T& key) {
+    if (root == NULL) {
+        root = new Node(key);
+        root->setRed(false);
+        return true;
+    }
+
+    //Split nodes with two red childs on the way down and repair red
+    //violations right away, so no pass back up is needed
+    Link head;
+    head.setLink(1, root);
+
+    Link* great = &head;
+    Node* grand = NULL;
+    Node* parent = NULL;
+    Node* node = root;
+    int dir = 0;
+    int last = 0;
+    bool inserted = false;
+
+    while (true) {
+        if (node == NULL) {
+            node = new Node(key);
+            parent->setLink(dir, node);
+            inserted = true;
+
+        } else if (isRed(node->link(0)) && isRed(node->link(1))) {
+            //Color flip
+            node->setRed(true);
+            node->link(0)->setRed(false);
+            node->link(1)->setRed(false);
+        }
+
+        //Two red nodes in a row
+        if (isRed(node) && isRed(parent)) {
+            int dir2 = (great->link(1) == grand);
+
+            if (node == parent->link(last)) {
+                great->setLink(dir2, rotate(grand, !last));
+            } else {
+                great->setLink(dir2, rotateTwice(grand, !last));
+            }
+        }
+
+        if (inserted || (!comp(node->key, key) && !comp(key, node->key))) {
+            break;
+        }
+
+        last = dir;
+        dir = comp(node->key, key);
+
+        if (grand != NULL) {
+            great = grand;
+        }
+
+        grand = parent;
+        parent = node;
+        node = node->link(dir);
+    }
+
+    root = head.link(1);
+    root->setRed(false);
+    return inserted;
+}
+
+template <typename T, typename Compare>
+bool RBTopDownTree<T, Compare>::remove(const T& key) {
+    if (root == NULL) {
+        return false;
+    }
+
+    //Push a red node down the search path, so the node that is finally
+    //removed is a red leaf or a node with one red child
+    Link head;
+    head.setLink(1, root);
+
+    Link* grand = NULL;
+    Link* parent = NULL;
+    Link* current = &head;
+    Node* node = NULL;
+    Node* found = NULL;
+    int dir = 1;
+
+    while (current->link(dir) != NULL) {
+        int last = dir;
+
+        grand = parent;
+        parent = current;
+        node = current->link(dir);
+        current = node;
+
+        dir = comp(node->key, key);
+
+        if (!dir && !comp(key, node->key)) {
+            found = node;
+        }
+
+        if (isRed(node) || isRed(node->link(dir))) {
+            continue;
+        }
+
+        if (isRed(node->link(!dir))) {
+            parent->setLink(last, rotate(node, dir));
+            parent = parent->link(last);
+
+        } else {
+            Node* sibling = parent->link(!last);
+
+            if (sibling == NULL) {
+                continue;
+            }
+
+            if (!isRed(sibling->link(0)) && !isRed(sibling->link(1))) {
+                //Color flip
+                parent->setRed(false);
+                sibling->setRed(true);
+                node->setRed(true);
+
+            } else {
+                int dir2 = (grand->link(1) == parent);
+                Node* top = static_cast<Node*>(parent);
+
+                if (isRed(sibling->link(last))) {
+                    grand->setLink(dir2, rotateTwice(top, last));
+                } else {
+                    grand->setLink(dir2, rotate(top, last));
+                }
+
+                //The new subtree root is red with two black childs
+                top = grand->link(dir2);
+                node->setRed(true);
+                top->setRed(true);
+                top->link(0)->setRed(false);
+                top->link(1)->setRed(false);
+            }
+        }
+    }
+
+    //The last node on the path is the in-order neighbour of the found node
+    if (found != NULL) {
+        if (found != node) {
+            found->key = std::move(node->key);
+        }
+
+        parent->setLink(parent->link(1) == node, node->link(node->link(0) == NULL));
+        delete node;
+    }
+
+    root = head.link(1);
+
+    if (root != NULL) {
+        root->setRed(false);
+    }
+
+    return found != NULL;
+}
+
+template <typename T, typename Compare>
+void RBTopDownTree<T, Compare>::clear() {
+    destroy(root);
+    root = NULL;
+}
+
+template <typename T, typename Compare>
+void RBTopDownTree<T, Compare>::iterator::descend(Node* node) {
+    while (node != NULL) {
+        path.push_back(node);
+        node = node->link(0);
+    }
+}
+
+template <typename T, typename Compare>
+typename RBTopDownTree<T, Compare>::iterator& RBTopDownTree<T, Compare>::iterator::operator++ () {
+    //Continue with the minimum of the right subtree, otherwise go up until
+    //the path comes out of a left subtree
+    Node* node = path.back();
+
+    if (node->link(1) != NULL) {
+        descend(node->link(1));
+        return *this;
+    }
+
+    path.pop_back();
+
+    while (!path.empty() && path.back()->link(1) == node) {
+        node = path.back();
+        path.pop_back();
+    }
+
+    return *this;
+}
+
+template <typename T, typename Compare>
+typename RBTopDownTree<T, Compare>::iterator RBTopDownTree<T, Compare>::begin() {
+    iterator it;
+    it.descend(root);
+    return it;
+}
+
+template <typename T, typename Compare>
+typename RBTopDownTree<T, Compare>::iterator RBTopDownTree<T, Compare>::end() {
+    return iterator();
+}
+
+template <typename T, typename Compare>
+typename RBTopDownTree<T, Compare>::iterator RBTopDownTree<T, Compare>::find(const T& key) {
+    //The path from the root to the found node is kept
+    iterator it;
+    Node* node = root;
+
+    while (node != NULL) {
+        it.path.push_back(node);
+
+        if (comp(key, node->key)) {
+            node = node->link(0);
+        } else if (comp(node->key, key)) {
+            node = node->link(1);
+        } else {
+            return it;
+        }
+    }
+
+    return end();
+}
+
+#ifdef DEBUG
+template <typename T, typename Compare>
+int RBTopDownTree<T, Compare>::invariantBlackNodes(const Node* node) {
+    //Returns the black height or -1 when a property is violated
+    if (node == NULL) {
+        return 1;
+    }
+
+    const Node* left = node->link(0);
+    const Node* right = node->link(1);
+
+    if (node->red() && (isRed(left) || isRed(right))) {
+        return -1;
+    }
+
+    if ((left != NULL && !comp(left->key, node->key)) ||
+        (right != NULL && !comp(node->key, right->key))) {
+        return -1;
+    }
+
+    int leftCount = invariantBlackNodes(left);
+    int rightCount = invariantBlackNodes(right);
+
+    return (leftCount == rightCount && leftCount != -1)
+           ? leftCount + !node->red()
+           : -1;
+}
+
+template <typename T, typename Compare>
+bool RBTopDownTree<T, Compare>::invariant() {
+    return root == NULL || (!root->red() && invariantBlackNodes(root) > -1);
+}
+#endif
+
+#endif /* RBTREE_TOPDOWN_H */